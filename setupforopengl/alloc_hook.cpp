@@ -0,0 +1,81 @@
+// alloc_hook.cpp
+// Hop Hop Bunny - heap allocation counter
+
+#include "alloc_hook.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static thread_local uint64_t threadCount = 0, threadBytes = 0;
+static std::atomic<uint64_t> totalCount{ 0 }, totalBytes{ 0 };
+
+static inline void countAlloc(size_t size) {
+    threadCount++;
+    threadBytes += size;
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+AllocStats allocStatsThread() {
+    AllocStats s;
+    s.count = threadCount;
+    s.bytes = threadBytes;
+    return s;
+}
+
+AllocStats allocStatsTotal() {
+    AllocStats s;
+    s.count = totalCount.load(std::memory_order_relaxed);
+    s.bytes = totalBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+static void* allocPlain(size_t size) {
+    countAlloc(size);
+    return std::malloc(size ? size : 1);
+}
+
+static void* allocAligned(size_t size, size_t align) {
+    countAlloc(size);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size ? size : 1) == 0 ? p : nullptr;
+#endif
+}
+
+static void freeAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(size_t size) { if (void* p = allocPlain(size)) return p; throw std::bad_alloc(); }
+void* operator new[](size_t size) { if (void* p = allocPlain(size)) return p; throw std::bad_alloc(); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocPlain(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocPlain(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void* operator new(size_t size, std::align_val_t a) { if (void* p = allocAligned(size, (size_t)a)) return p; throw std::bad_alloc(); }
+void* operator new[](size_t size, std::align_val_t a) { if (void* p = allocAligned(size, (size_t)a)) return p; throw std::bad_alloc(); }
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return allocAligned(size, (size_t)a); }
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return allocAligned(size, (size_t)a); }
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
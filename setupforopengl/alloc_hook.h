@@ -0,0 +1,17 @@
+// alloc_hook.h
+// Hop Hop Bunny - heap allocation counter
+// alloc_hook.cpp replaces the global operator new/delete with malloc/free wrappers that count
+// every allocation, in total and per thread. Link it into a program at most once. Only C++
+// allocations are seen; C libraries (GLFW, the GL driver) call malloc directly.
+
+#pragma once
+
+#include <cstdint>
+
+struct AllocStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocStats allocStatsThread();   // allocations made by the calling thread
+AllocStats allocStatsTotal();    // all threads
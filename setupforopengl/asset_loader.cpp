@@ -0,0 +1,89 @@
+// asset_loader.cpp
+// Hop Hop Bunny - asynchronous image loading
+
+#include "asset_loader.h"
+
+#include <stb/stb_image.h>
+
+#include <cassert>
+#include <iostream>
+
+AssetLoader::AssetLoader(WorkPool& p, int groups) : pool(p), groupCount(groups), remaining(new std::atomic<int>[groups]) {
+    for (int g = 0; g < groupCount; g++) remaining[g] = 0;
+}
+
+AssetLoader::~AssetLoader() {
+    std::unique_lock<std::mutex> lk(tasksMutex);
+    tasksDone.wait(lk, [&] { return tasksLeft == 0; });
+}
+
+int AssetLoader::add(const std::string& path, int group) {
+    assert(group >= 0 && group < groupCount);
+    entries.push_back({ path, group, AtlasImage() });
+    remaining[group]++;
+    return (int)entries.size() - 1;
+}
+
+void AssetLoader::start(int maxPageSize) {
+    pageSize = maxPageSize;
+    {
+        std::lock_guard<std::mutex> lk(tasksMutex);
+        tasksLeft = (int)entries.size();
+        for (int g = 0; g < groupCount; g++) if (remaining[g] == 0) tasksLeft++;
+    }
+    for (int g = 0; g < groupCount; g++) {
+        if (remaining[g] == 0) pool.submit([this, g](int) { packGroup(g); taskDone(); });   // empty group is ready at once
+    }
+    for (int i = 0; i < (int)entries.size(); i++) pool.submit([this, i](int) { decode(i); taskDone(); });
+}
+
+void AssetLoader::taskDone() {
+    std::lock_guard<std::mutex> lk(tasksMutex);
+    if (--tasksLeft == 0) tasksDone.notify_all();
+}
+
+void AssetLoader::decode(int index) {
+    Entry& e = entries[index];
+    e.image.name = e.path;
+
+    int tc = 0;
+    stbi_set_flip_vertically_on_load_thread(1);
+    unsigned char* d = stbi_load(e.path.c_str(), &e.image.w, &e.image.h, &tc, 4);
+    if (d) {
+        e.image.rgba.assign(d, d + (size_t)e.image.w * e.image.h * 4);
+        stbi_image_free(d);
+    }
+    else {
+        std::cerr << "Failed load: " << e.path << "\n";
+    }
+
+    if (--remaining[e.group] == 0) packGroup(e.group);
+}
+
+void AssetLoader::packGroup(int group) {
+    AssetGroupResult r;
+    r.group = group;
+    std::vector<const AtlasImage*> images;
+    for (int i = 0; i < (int)entries.size(); i++) {
+        if (entries[i].group != group) continue;
+        images.push_back(&entries[i].image);
+        r.images.push_back(i);
+        r.looseBytes += entries[i].image.rgba.size();
+    }
+    if (!packAtlas(images, pageSize, r.atlas)) std::cerr << "Atlas packing failed for group " << group << "\n";
+
+    // decoded pixels now live in the pages
+    for (int i : r.images) { entries[i].image.rgba.clear(); entries[i].image.rgba.shrink_to_fit(); }
+
+    std::lock_guard<std::mutex> lk(readyMutex);
+    ready.push_back(std::move(r));
+}
+
+bool AssetLoader::takeReady(AssetGroupResult& out) {
+    std::lock_guard<std::mutex> lk(readyMutex);
+    if (ready.empty()) return false;
+    out = std::move(ready.front());
+    ready.erase(ready.begin());
+    taken++;
+    return true;
+}
@@ -0,0 +1,71 @@
+// asset_loader.h
+// Hop Hop Bunny - asynchronous image loading
+// PNGs are decoded on the WorkPool. When every image of a group has been decoded, the
+// worker that finished last packs that group into its own atlas pages. The main thread
+// polls takeReady() and uploads the pages to GL, so the title screen can be shown as
+// soon as its group is in while the gameplay group is still decoding.
+
+#pragma once
+
+#include "atlas.h"
+#include "work_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct AssetGroupResult {
+    int group = -1;
+    Atlas atlas;
+    std::vector<int> images;   // image index (from add()) of each atlas.sprites entry
+    size_t looseBytes = 0;     // decoded size before trimming/packing, for logging
+};
+
+class AssetLoader {
+public:
+    AssetLoader(WorkPool& pool, int groupCount);
+    // Waits for the decode and pack tasks still running: they write into this object.
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Register an image before start(); returns its index. group is in [0, groupCount).
+    int add(const std::string& path, int group);
+
+    // Kick off decoding. maxPageSize bounds the atlas pages of every group.
+    void start(int maxPageSize);
+
+    // Main thread: pop a group that is decoded and packed. Returns false if none is ready yet.
+    bool takeReady(AssetGroupResult& out);
+
+    bool allTaken() const { return taken == groupCount; }
+
+private:
+    struct Entry {
+        std::string path;
+        int group;
+        AtlasImage image;
+    };
+
+    void decode(int index);
+    void packGroup(int group);
+    void taskDone();
+
+    WorkPool& pool;
+    int groupCount;
+    int pageSize = 4096;
+    int taken = 0;
+    std::vector<Entry> entries;
+    std::unique_ptr<std::atomic<int>[]> remaining;   // undecoded images per group
+
+    std::mutex readyMutex;
+    std::vector<AssetGroupResult> ready;
+
+    std::mutex tasksMutex;
+    std::condition_variable tasksDone;
+    int tasksLeft = 0;                                // submitted by start() and not finished
+};
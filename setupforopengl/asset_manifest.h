@@ -0,0 +1,60 @@
+// asset_manifest.h
+// Hop Hop Bunny - list of every asset the game loads
+// Shared by the game and the bake tool (bake_assets.cpp) so the archive always holds exactly
+// what flappy.cpp asks for. Paths are relative to the working directory and double as the
+// lookup names inside the archive.
+
+#pragma once
+
+#include <cstring>
+
+// The title group is waited for before the first frame; the game group streams in behind it.
+enum AssetGroup { ASSET_GROUP_TITLE = 0, ASSET_GROUP_GAME = 1, ASSET_GROUP_COUNT = 2 };
+
+struct AssetManifestEntry {
+    const char* path;
+    int group;
+};
+
+static const AssetManifestEntry ASSET_IMAGES[] = {
+    // title screen: buttons, bunny animation, clouds, grass, title text
+    { "buttons/START button.png", ASSET_GROUP_TITLE },
+    { "buttons/EXIT button.png", ASSET_GROUP_TITLE },
+    { "bunny sequence/bunny_sequence 1.png", ASSET_GROUP_TITLE },
+    { "bunny sequence/bunny_sequence 2.png", ASSET_GROUP_TITLE },
+    { "clouds/cloud1.png", ASSET_GROUP_TITLE },
+    { "clouds/cloud2.png", ASSET_GROUP_TITLE },
+    { "ground/grass.png", ASSET_GROUP_TITLE },
+    { "text/game title.png", ASSET_GROUP_TITLE },
+
+    // everything only needed once a run starts or ends
+    { "buttons/RESET button.png", ASSET_GROUP_GAME },
+    { "bunny sequence/bunny died.png", ASSET_GROUP_GAME },
+    { "numbers/0.png", ASSET_GROUP_GAME }, { "numbers/1.png", ASSET_GROUP_GAME },
+    { "numbers/2.png", ASSET_GROUP_GAME }, { "numbers/3.png", ASSET_GROUP_GAME },
+    { "numbers/4.png", ASSET_GROUP_GAME }, { "numbers/5.png", ASSET_GROUP_GAME },
+    { "numbers/6.png", ASSET_GROUP_GAME }, { "numbers/7.png", ASSET_GROUP_GAME },
+    { "numbers/8.png", ASSET_GROUP_GAME }, { "numbers/9.png", ASSET_GROUP_GAME },
+    { "text/game over.png", ASSET_GROUP_GAME },
+    { "text/best score.png", ASSET_GROUP_GAME },
+    { "bestscores/0.png", ASSET_GROUP_GAME }, { "bestscores/1.png", ASSET_GROUP_GAME },
+    { "bestscores/2.png", ASSET_GROUP_GAME }, { "bestscores/3.png", ASSET_GROUP_GAME },
+    { "bestscores/4.png", ASSET_GROUP_GAME }, { "bestscores/5.png", ASSET_GROUP_GAME },
+    { "bestscores/6.png", ASSET_GROUP_GAME }, { "bestscores/7.png", ASSET_GROUP_GAME },
+    { "bestscores/8.png", ASSET_GROUP_GAME }, { "bestscores/9.png", ASSET_GROUP_GAME },
+};
+
+static const char* const ASSET_SOUNDS[] = {
+    "sounds/hop.wav",
+    "sounds/death.wav",
+};
+
+static const int ASSET_IMAGE_COUNT = (int)(sizeof(ASSET_IMAGES) / sizeof(ASSET_IMAGES[0]));
+static const int ASSET_SOUND_COUNT = (int)(sizeof(ASSET_SOUNDS) / sizeof(ASSET_SOUNDS[0]));
+
+// Group of a manifest image, -1 if the path is not listed.
+inline int assetImageGroup(const char* path) {
+    for (int i = 0; i < ASSET_IMAGE_COUNT; i++)
+        if (strcmp(ASSET_IMAGES[i].path, path) == 0) return ASSET_IMAGES[i].group;
+    return -1;
+}
@@ -0,0 +1,144 @@
+// asset_pack.cpp
+// Hop Hop Bunny - baked asset archive
+
+#include "asset_pack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Maps the whole file read-only. The file/mapping handles are closed right away; the view
+// keeps the file alive until it is unmapped.
+static const unsigned char* mapFile(const char* path, size_t& size) {
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER len;
+    if (!GetFileSizeEx(f, &len) || len.QuadPart == 0) { CloseHandle(f); return nullptr; }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(f);
+    if (!m) return nullptr;
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(m);
+    if (!p) return nullptr;
+    size = (size_t)len.QuadPart;
+    return (const unsigned char*)p;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return nullptr; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return nullptr;
+    size = (size_t)st.st_size;
+    return (const unsigned char*)p;
+#endif
+}
+
+static void unmapFile(const unsigned char* p, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(p);
+#else
+    munmap((void*)p, size);
+#endif
+}
+
+bool AssetPack::open(const char* path) {
+    close();
+    base = mapFile(path, size);
+    if (!base) return false;
+    if (!validate(path)) { close(); return false; }
+    return true;
+}
+
+void AssetPack::close() {
+    if (base) unmapFile(base, size);
+    base = nullptr; size = 0;
+    entries = nullptr; entryCount = 0; names = nullptr;
+}
+
+bool AssetPack::validate(const char* path) {
+    auto fail = [&](const char* why) { std::cerr << path << ": " << why << "\n"; return false; };
+
+    if (size < sizeof(PackHeader)) return fail("too small");
+    PackHeader h;
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, PACK_MAGIC, 4) != 0) return fail("not an asset pack");
+    if (h.version != PACK_VERSION) return fail("pack version mismatch, rebake it");
+    if (h.fileSize != size) return fail("truncated");
+
+    uint64_t tocEnd = sizeof(PackHeader) + (uint64_t)h.entryCount * sizeof(PackEntry);
+    if (tocEnd + h.namesSize > size) return fail("table of contents out of range");
+    if (h.namesSize && base[tocEnd + h.namesSize - 1] != 0) return fail("bad name table");
+
+    entries = (const PackEntry*)(base + sizeof(PackHeader));
+    entryCount = (int)h.entryCount;
+    names = (const char*)(base + tocEnd);
+
+    for (int i = 0; i < entryCount; i++) {
+        const PackEntry& e = entries[i];
+        if (e.name != PACK_NO_NAME && e.name >= h.namesSize) return fail("entry name out of range");
+        if (e.offset > size || e.size > size - e.offset) return fail("entry payload out of range");
+        if (e.type == PACK_PAGE && (uint64_t)e.w * e.h * 4 != e.size) return fail("page size mismatch");
+        if (e.type == PACK_SPRITE && (e.page < 0 || e.page >= entryCount || entries[e.page].type != PACK_PAGE))
+            return fail("sprite refers to a missing page");
+    }
+    return true;
+}
+
+uint64_t packHashBytes(const void* data, size_t size) {
+    const unsigned char* b = (const unsigned char*)data;
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) { h ^= b[i]; h *= 0x100000001B3ull; }
+    return h;
+}
+
+bool packSourceStat(const char* path, uint64_t& size, int64_t& mtime) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0) return false;
+#else
+    struct stat st;
+    if (::stat(path, &st) != 0) return false;
+#endif
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+bool AssetPack::sourceChanged(const PackEntry& e, const char* path) const {
+    uint64_t srcSize = 0;
+    int64_t srcMtime = 0;
+    if (!packSourceStat(path, srcSize, srcMtime)) return false;
+    if (srcSize != e.srcSize) return true;
+    if (srcMtime == e.srcMtime) return false;
+
+    FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    std::vector<unsigned char> bytes((size_t)srcSize);
+    bool read = std::fread(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    std::fclose(f);
+    return !read || packHashBytes(bytes.data(), bytes.size()) != e.srcHash;
+}
+
+int AssetPack::find(const char* n, uint32_t type) const {
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].type == type && entries[i].name != PACK_NO_NAME && strcmp(names + entries[i].name, n) == 0) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,99 @@
+// asset_pack.h
+// Hop Hop Bunny - baked asset archive
+// bake_assets packs every image of asset_manifest.h into atlas pages (one set per group) and
+// stores them as raw RGBA8, plus the sounds as their WAV bytes, in one file with a table of
+// contents. The game maps that file and hands page pointers straight to glTexImage2D: no file
+// per asset, no PNG inflate, no copy of the pixels on the CPU side.
+//
+// Layout (little-endian): PackHeader | PackEntry[entryCount] | name table | payloads.
+// Every payload starts on a PACK_ALIGN boundary.
+// Sprites and sounds record the size, modification time and FNV-1a hash of the file they were
+// baked from, so the game can tell when a PNG or WAV was edited in place since the bake.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+static const char PACK_MAGIC[4] = { 'H', 'H', 'B', 'P' };
+static const uint32_t PACK_VERSION = 2;
+static const uint32_t PACK_ALIGN = 64;
+static const uint32_t PACK_NO_NAME = 0xFFFFFFFFu;
+
+enum PackEntryType : uint32_t {
+    PACK_PAGE = 1,     // atlas page, w x h RGBA8, rows bottom-up
+    PACK_SPRITE = 2,   // named image: which page and where on it (no payload)
+    PACK_SOUND = 3,    // named sound, payload is the whole .wav file
+};
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t namesSize;
+    uint64_t fileSize;
+};
+
+struct PackEntry {
+    uint32_t type;
+    int32_t group;
+    uint32_t name;                                  // offset into the name table, PACK_NO_NAME for pages
+    int32_t page;                                   // sprites: entry index of their page
+    uint64_t offset, size;                          // payload, from the start of the file
+    int32_t w, h;                                   // pages: size in pixels
+    float u0, v0, u1, v1;                           // sprites: same meaning as AtlasSprite
+    float fx0, fy0, fx1, fy1;
+    uint64_t srcSize;                               // sprites and sounds: the source file when baked
+    int64_t srcMtime;                               // seconds since 1970
+    uint64_t srcHash;                               // FNV-1a of the file's bytes
+};
+
+static_assert(sizeof(PackHeader) == 24, "pack header layout");
+static_assert(sizeof(PackEntry) == 96, "pack entry layout");
+
+// FNV-1a over a source file's bytes, as stored in srcHash.
+uint64_t packHashBytes(const void* data, size_t size);
+
+// Size and modification time of a loose file; false if it doesn't exist.
+bool packSourceStat(const char* path, uint64_t& size, int64_t& mtime);
+
+// Read-only view of a pack file, memory-mapped for as long as the object lives.
+class AssetPack {
+public:
+    AssetPack() {}
+    ~AssetPack() { close(); }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Returns false if the file is missing or fails validation (the reason is printed unless
+    // the file simply does not exist).
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    int count() const { return entryCount; }
+    const PackEntry& entry(int i) const { return entries[i]; }
+    const char* name(const PackEntry& e) const { return e.name == PACK_NO_NAME ? "" : names + e.name; }
+    const unsigned char* data(const PackEntry& e) const { return base + e.offset; }
+
+    // Index of the entry with this name and type, -1 if there is none.
+    int find(const char* name, uint32_t type) const;
+
+    // True if the loose file at path differs from what entry e was baked from. Same size and
+    // mtime count as unchanged; a different mtime alone reads the file and compares the hash
+    // (a fresh checkout touches every file). A missing loose file is not stale: the pack is
+    // all there is.
+    bool sourceChanged(const PackEntry& e, const char* path) const;
+
+    size_t fileSize() const { return size; }
+
+private:
+    bool validate(const char* path);
+
+    const unsigned char* base = nullptr;
+    size_t size = 0;
+    const PackEntry* entries = nullptr;
+    int entryCount = 0;
+    const char* names = nullptr;
+};
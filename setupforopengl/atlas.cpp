@@ -0,0 +1,103 @@
+// atlas.cpp
+// Hop Hop Bunny - texture atlas packer
+
+#include "atlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Transparent texels kept around each trimmed rect. With linear filtering the sprite edge then
+// still blends towards transparent exactly like the untrimmed texture did, and neighbours on
+// the page can never bleed in.
+static const int BORDER = 1;
+static const int PADDING = 1;
+
+struct TrimRect { int x0, y0, x1, y1; };   // inclusive-exclusive, in source pixels
+
+static bool findOpaqueBounds(const AtlasImage& img, TrimRect& r) {
+    r = { img.w, img.h, 0, 0 };
+    for (int y = 0; y < img.h; y++) {
+        const unsigned char* row = &img.rgba[(size_t)y * img.w * 4];
+        for (int x = 0; x < img.w; x++) {
+            if (!row[x * 4 + 3]) continue;
+            r.x0 = std::min(r.x0, x); r.x1 = std::max(r.x1, x + 1);
+            r.y0 = std::min(r.y0, y); r.y1 = std::max(r.y1, y + 1);
+        }
+    }
+    if (r.x0 >= r.x1) return false;
+    r.x0 = std::max(0, r.x0 - BORDER); r.y0 = std::max(0, r.y0 - BORDER);
+    r.x1 = std::min(img.w, r.x1 + BORDER); r.y1 = std::min(img.h, r.y1 + BORDER);
+    return true;
+}
+
+bool packAtlas(const std::vector<const AtlasImage*>& images, int maxPageSize, Atlas& out) {
+    out.pages.clear();
+    out.sprites.assign(images.size(), AtlasSprite());
+
+    std::vector<TrimRect> trim(images.size());
+    std::vector<int> order;
+    for (size_t i = 0; i < images.size(); i++) {
+        const AtlasImage* img = images[i];
+        if (!img || img->rgba.empty() || !findOpaqueBounds(*img, trim[i])) continue;
+        int w = trim[i].x1 - trim[i].x0, h = trim[i].y1 - trim[i].y0;
+        if (w + 2 * PADDING > maxPageSize || h + 2 * PADDING > maxPageSize) return false;
+        order.push_back((int)i);
+    }
+
+    // tallest first keeps shelves tight
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        int ha = trim[a].y1 - trim[a].y0, hb = trim[b].y1 - trim[b].y0;
+        return ha != hb ? ha > hb : a < b;
+        });
+
+    // shelf packing: fill a row left to right, open a new shelf below, new page when full
+    int page = -1, shelfX = 0, shelfY = 0, shelfH = 0;
+    std::vector<int> pageUsedH;
+    for (int i : order) {
+        int w = trim[i].x1 - trim[i].x0 + 2 * PADDING;
+        int h = trim[i].y1 - trim[i].y0 + 2 * PADDING;
+        if (page < 0 || shelfX + w > maxPageSize) { shelfY += shelfH; shelfX = 0; shelfH = 0; }
+        if (page < 0 || shelfY + h > maxPageSize) {
+            page++; pageUsedH.push_back(0);
+            shelfX = 0; shelfY = 0; shelfH = 0;
+        }
+        AtlasSprite& s = out.sprites[i];
+        s.page = page;
+        s.x = shelfX + PADDING; s.y = shelfY + PADDING;
+        s.w = w - 2 * PADDING; s.h = h - 2 * PADDING;
+        shelfX += w;
+        shelfH = std::max(shelfH, h);
+        pageUsedH[page] = std::max(pageUsedH[page], shelfY + shelfH);
+    }
+
+    // pages are only as tall as their content (rounded to 4 rows)
+    out.pages.resize(pageUsedH.size());
+    for (size_t p = 0; p < out.pages.size(); p++) {
+        out.pages[p].w = maxPageSize;
+        out.pages[p].h = std::min(maxPageSize, (pageUsedH[p] + 3) & ~3);
+        out.pages[p].rgba.assign((size_t)out.pages[p].w * out.pages[p].h * 4, 0);
+    }
+
+    for (int i : order) {
+        const AtlasImage& img = *images[i];
+        const TrimRect& t = trim[i];
+        AtlasSprite& s = out.sprites[i];
+        AtlasPage& pg = out.pages[s.page];
+        for (int row = 0; row < s.h; row++) {
+            const unsigned char* src = &img.rgba[((size_t)(t.y0 + row) * img.w + t.x0) * 4];
+            unsigned char* dst = &pg.rgba[((size_t)(s.y + row) * pg.w + s.x) * 4];
+            std::memcpy(dst, src, (size_t)s.w * 4);
+        }
+        s.u0 = (float)s.x / pg.w; s.u1 = (float)(s.x + s.w) / pg.w;
+        s.v0 = (float)s.y / pg.h; s.v1 = (float)(s.y + s.h) / pg.h;
+        s.fx0 = (float)t.x0 / img.w; s.fx1 = (float)t.x1 / img.w;
+        s.fy0 = (float)t.y0 / img.h; s.fy1 = (float)t.y1 / img.h;
+    }
+    return true;
+}
+
+size_t atlasBytes(const Atlas& a) {
+    size_t n = 0;
+    for (const AtlasPage& p : a.pages) n += p.rgba.size();
+    return n;
+}
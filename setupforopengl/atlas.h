@@ -0,0 +1,41 @@
+// atlas.h
+// Hop Hop Bunny - texture atlas packer
+// Trims the transparent border off every image and shelf-packs the trimmed rects into a few
+// large RGBA pages. CPU only (no GL), so it can run at load time or in an offline bake step.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// One decoded source image (RGBA8, rows bottom-up as loaded with stbi flip on).
+struct AtlasImage {
+    std::string name;
+    int w = 0, h = 0;
+    std::vector<unsigned char> rgba;
+};
+
+// Where a packed image ended up.
+struct AtlasSprite {
+    int page = -1;                                      // -1: image was fully transparent / missing
+    float u0 = 0, v0 = 0, u1 = 0, v1 = 0;               // trimmed rect in page UVs
+    float fx0 = 0, fy0 = 0, fx1 = 1, fy1 = 1;           // trimmed rect as a fraction of the source frame (y up)
+    int x = 0, y = 0, w = 0, h = 0;                     // trimmed rect in page pixels
+};
+
+struct AtlasPage {
+    int w = 0, h = 0;
+    std::vector<unsigned char> rgba;
+};
+
+struct Atlas {
+    std::vector<AtlasPage> pages;
+    std::vector<AtlasSprite> sprites;   // same order as the input images
+};
+
+// maxPageSize bounds both page dimensions (use GL_MAX_TEXTURE_SIZE, capped to taste).
+// Returns false if an image does not fit on a page even on its own.
+bool packAtlas(const std::vector<const AtlasImage*>& images, int maxPageSize, Atlas& out);
+
+// Bytes of RGBA the pages take, for logging.
+size_t atlasBytes(const Atlas& a);
@@ -0,0 +1,348 @@
+// audio.cpp
+// Hop Hop Bunny - sound mixer
+
+#include "audio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t rd32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t rd16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static void wr32(unsigned char* p, uint32_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24); }
+static void wr16(unsigned char* p, uint16_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+
+bool parseWav(const unsigned char* data, size_t size, Sound& out) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) return false;
+
+    int channels = 0, bits = 0, format = 0;
+    uint32_t rate = 0;
+    const unsigned char* pcm = nullptr;
+    size_t pcmBytes = 0;
+    for (size_t p = 12; p + 8 <= size;) {
+        uint32_t len = rd32(data + p + 4);
+        const unsigned char* body = data + p + 8;
+        size_t avail = std::min<size_t>(len, size - p - 8);
+        if (memcmp(data + p, "fmt ", 4) == 0 && avail >= 16) {
+            format = rd16(body);
+            channels = rd16(body + 2);
+            rate = rd32(body + 4);
+            bits = rd16(body + 14);
+            if (format == 0xFFFE && avail >= 26) format = rd16(body + 24);   // WAVE_FORMAT_EXTENSIBLE: sub-format GUID starts with the tag
+        }
+        else if (memcmp(data + p, "data", 4) == 0) {
+            pcm = body;
+            pcmBytes = avail;
+        }
+        p += 8 + (size_t)len + (len & 1);   // chunks are word aligned
+    }
+    if (format != 1 || bits != 16 || (channels != 1 && channels != 2) || !pcm || !rate) return false;
+
+    out.rate = (int)rate;
+    out.frames = (int)(pcmBytes / (2 * channels));
+    out.pcm.resize((size_t)out.frames * 2);
+    for (int f = 0; f < out.frames; f++) {
+        int16_t l = (int16_t)rd16(pcm + (size_t)f * 2 * channels);
+        int16_t r = channels == 2 ? (int16_t)rd16(pcm + (size_t)f * 4 + 2) : l;
+        out.pcm[(size_t)f * 2] = l;
+        out.pcm[(size_t)f * 2 + 1] = r;
+    }
+    return true;
+}
+
+bool loadWav(const char* path, Sound& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<unsigned char> bytes;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (n > 0) {
+        bytes.resize((size_t)n);
+        if (fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) bytes.clear();
+    }
+    fclose(f);
+    return !bytes.empty() && parseWav(bytes.data(), bytes.size(), out);
+}
+
+bool saveWav(const char* path, const int16_t* pcm, int frames, int rate) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint32_t dataBytes = (uint32_t)frames * 4;
+    unsigned char h[44];
+    memcpy(h, "RIFF", 4); wr32(h + 4, 36 + dataBytes); memcpy(h + 8, "WAVE", 4);
+    memcpy(h + 12, "fmt ", 4); wr32(h + 16, 16); wr16(h + 20, 1); wr16(h + 22, 2);
+    wr32(h + 24, (uint32_t)rate); wr32(h + 28, (uint32_t)rate * 4); wr16(h + 32, 4); wr16(h + 34, 16);
+    memcpy(h + 36, "data", 4); wr32(h + 40, dataBytes);
+    bool ok = fwrite(h, 1, sizeof(h), f) == sizeof(h);
+    // samples are written as-is: every platform this builds on is little-endian
+    if (frames > 0) ok = ok && fwrite(pcm, 4, (size_t)frames, f) == (size_t)frames;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+int AudioEngine::addSound(const Sound& s) {
+    if (running()) { std::cerr << "Audio: sounds must be added before init\n"; return -1; }
+    if (s.frames <= 0) return -1;
+    sounds.push_back(s);
+    return (int)sounds.size() - 1;
+}
+
+bool AudioEngine::init(AudioBackend be, int outRate, int block, int buffers, const char* path) {
+    shutdown();
+    backend = be;
+    rate = outRate;
+    blockFrames = std::max(16, block);
+    bufferCount = std::max(2, buffers);
+    filePath = path ? path : "";
+    kern = &mixKernels(mixBestPath());
+    accum.assign((size_t)blockFrames * 2, 0.0f);
+
+    if (backend == AudioBackend::File && filePath.empty()) { std::cerr << "Audio: file backend needs a path\n"; return false; }
+
+#ifdef _WIN32
+    if (backend == AudioBackend::Device) {
+        WAVEFORMATEX fmt = {};
+        fmt.wFormatTag = WAVE_FORMAT_PCM;
+        fmt.nChannels = 2;
+        fmt.nSamplesPerSec = (DWORD)rate;
+        fmt.wBitsPerSample = 16;
+        fmt.nBlockAlign = 4;
+        fmt.nAvgBytesPerSec = (DWORD)rate * 4;
+        HANDLE ev = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+        HWAVEOUT wo = nullptr;
+        if (!ev || waveOutOpen(&wo, WAVE_MAPPER, &fmt, (DWORD_PTR)ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+            if (ev) CloseHandle(ev);
+            std::cerr << "Audio: no output device, sound is muted\n";
+            backend = AudioBackend::Null;
+        }
+        else {
+            device = wo;
+            deviceEvent = ev;
+        }
+    }
+#else
+    if (backend == AudioBackend::Device) {
+        std::cerr << "Audio: no device backend on this platform, using the null backend\n";
+        backend = AudioBackend::Null;
+    }
+#endif
+
+    if (backend == AudioBackend::Manual) return true;
+    quit = false;
+    thread = std::thread([this]() { threadMain(); });
+    return true;
+}
+
+void AudioEngine::shutdown() {
+    if (!thread.joinable()) return;
+    quit = true;
+    thread.join();
+    device = deviceEvent = nullptr;
+    if (backend == AudioBackend::File) {
+        if (!saveWav(filePath.c_str(), recorded.data(), (int)(recorded.size() / 2), rate))
+            std::cerr << "Audio: failed writing " << filePath << "\n";
+        recorded.clear();
+    }
+}
+
+bool AudioEngine::push(const Command& c) {
+    uint32_t tail = queueTail.load(std::memory_order_relaxed);
+    if (tail - queueHead.load(std::memory_order_acquire) >= (uint32_t)QUEUE_SIZE) { statDropped++; return false; }
+    queue[tail & (QUEUE_SIZE - 1)] = c;
+    queueTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+int AudioEngine::play(int sound, float gain, bool loop, float pitch) {
+    if (sound < 0 || sound >= (int)sounds.size() || !(pitch > 0.0f)) return -1;
+    Command c = { CMD_PLAY, loop, sound, nextVoiceId++, gain, pitch, nowNs() };
+    return push(c) ? c.voice : -1;
+}
+
+void AudioEngine::stop(int voice) {
+    if (voice < 0) return;
+    Command c = { CMD_STOP, false, 0, voice, 0.0f, 1.0f, nowNs() };
+    push(c);
+}
+
+void AudioEngine::stopAll() {
+    Command c = { CMD_STOP_ALL, false, 0, -1, 0.0f, 1.0f, nowNs() };
+    push(c);
+}
+
+void AudioEngine::drainCommands() {
+    uint32_t head = queueHead.load(std::memory_order_relaxed);
+    uint32_t tail = queueTail.load(std::memory_order_acquire);
+    if (head == tail) return;
+    int64_t now = nowNs();
+    for (; head != tail; head++) {
+        const Command& c = queue[head & (QUEUE_SIZE - 1)];
+        if (c.type == CMD_PLAY) {
+            // a free slot, else steal the one-shot that is furthest along
+            int best = -1;
+            for (int v = 0; v < MAX_VOICES; v++) {
+                if (voices[v].id < 0) { best = v; break; }
+                if (!voices[v].loop && (best < 0 || voices[v].pos > voices[best].pos)) best = v;
+            }
+            if (best < 0) continue;
+            Voice& v = voices[best];
+            v.id = c.voice; v.sound = c.sound; v.pos = 0; v.gain = c.gain; v.loop = c.loop;
+            int srcRate = sounds[c.sound].rate;
+            if (srcRate == rate && c.pitch == 1.0f) v.step = (uint64_t)1 << 32;
+            else v.step = std::max<uint64_t>(1, (uint64_t)std::llround((double)srcRate / rate * c.pitch * 4294967296.0));
+
+            int64_t waited = now - c.issued;
+            statPickups++;
+            statPickupNs += waited;
+            if (waited > statPickupMaxNs) statPickupMaxNs = waited;
+        }
+        else if (c.type == CMD_STOP) {
+            for (Voice& v : voices) if (v.id == c.voice) v.id = -1;
+        }
+        else {
+            for (Voice& v : voices) v.id = -1;
+        }
+    }
+    queueHead.store(head, std::memory_order_release);
+}
+
+void AudioEngine::mixBlock(int16_t* out, int frames) {
+    std::fill(accum.begin(), accum.begin() + (size_t)frames * 2, 0.0f);
+    const uint64_t ONE = (uint64_t)1 << 32;
+
+    int active = 0;
+    uint64_t voiceFrames = 0;
+    for (Voice& v : voices) {
+        if (v.id < 0) continue;
+        active++;
+        const Sound& s = sounds[v.sound];
+        float g = v.gain * (1.0f / 32768.0f);
+        int done = 0;
+        if (v.step == ONE) {
+            while (done < frames) {
+                int at = (int)(v.pos >> 32);
+                int n = std::min(frames - done, s.frames - at);
+                kern->add(&accum[(size_t)done * 2], &s.pcm[(size_t)at * 2], n * 2, g);
+                done += n;
+                v.pos += (uint64_t)n << 32;
+                voiceFrames += n;
+                if (at + n >= s.frames) {
+                    if (!v.loop) { v.id = -1; break; }
+                    v.pos = 0;
+                }
+            }
+            continue;
+        }
+
+        // interpolation reads the frame after pos, so pos has to stay below the last frame
+        uint64_t end = (uint64_t)(s.frames - 1) << 32;
+        while (done < frames) {
+            if (v.pos >= end) {
+                if (!v.loop || s.frames < 2) { v.id = -1; break; }
+                v.pos -= end;
+                continue;
+            }
+            uint64_t avail = (end - v.pos + v.step - 1) / v.step;
+            int n = (int)std::min<uint64_t>((uint64_t)(frames - done), avail);
+            v.pos = kern->resampleAdd(&accum[(size_t)done * 2], s.pcm.data(), v.pos, v.step, n, g);
+            done += n;
+            voiceFrames += n;
+        }
+    }
+    if (active > statVoicesPeak) statVoicesPeak = active;
+    statVoiceFrames += voiceFrames;
+
+    kern->convert(out, accum.data(), frames * 2);
+}
+
+void AudioEngine::mix(int16_t* out, int frames) {
+    int64_t t0 = nowNs();
+    if (accum.size() < (size_t)blockFrames * 2) accum.assign((size_t)blockFrames * 2, 0.0f);
+    drainCommands();
+    while (frames > 0) {
+        int n = std::min(frames, blockFrames);
+        mixBlock(out, n);
+        out += (size_t)n * 2;
+        frames -= n;
+        statBlocks++;
+    }
+    statMixNs += nowNs() - t0;
+}
+
+void AudioEngine::threadMain() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    if (backend == AudioBackend::Device) {
+        HWAVEOUT wo = (HWAVEOUT)device;
+        HANDLE ev = (HANDLE)deviceEvent;
+        std::vector<int16_t> pcm((size_t)blockFrames * 2 * bufferCount);
+        std::vector<WAVEHDR> hdr(bufferCount);
+        for (int i = 0; i < bufferCount; i++) {
+            hdr[i] = WAVEHDR();
+            hdr[i].lpData = (LPSTR)&pcm[(size_t)i * blockFrames * 2];
+            hdr[i].dwBufferLength = (DWORD)blockFrames * 4;
+            waveOutPrepareHeader(wo, &hdr[i], sizeof(WAVEHDR));
+            mix((int16_t*)hdr[i].lpData, blockFrames);
+            waveOutWrite(wo, &hdr[i], sizeof(WAVEHDR));
+        }
+        // buffers come back in the order they were queued
+        int next = 0;
+        while (!quit) {
+            WaitForSingleObject(ev, 50);
+            while (hdr[next].dwFlags & WHDR_DONE) {
+                mix((int16_t*)hdr[next].lpData, blockFrames);
+                waveOutWrite(wo, &hdr[next], sizeof(WAVEHDR));
+                next = (next + 1) % bufferCount;
+            }
+        }
+        waveOutReset(wo);
+        for (int i = 0; i < bufferCount; i++) waveOutUnprepareHeader(wo, &hdr[i], sizeof(WAVEHDR));
+        waveOutClose(wo);
+        CloseHandle(ev);
+        return;
+    }
+#endif
+
+    // Null / File: paced by the clock like a device pulling one block at a time
+    std::vector<int16_t> block((size_t)blockFrames * 2);
+    auto period = std::chrono::nanoseconds((int64_t)blockFrames * 1000000000 / rate);
+    auto next = std::chrono::steady_clock::now();
+    while (!quit) {
+        mix(block.data(), blockFrames);
+        if (backend == AudioBackend::File) recorded.insert(recorded.end(), block.begin(), block.end());
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+AudioStats AudioEngine::stats() const {
+    AudioStats s;
+    s.blocks = statBlocks;
+    s.voicesPeak = statVoicesPeak;
+    s.commandsDropped = statDropped;
+    uint64_t pickups = statPickups;
+    if (pickups) s.pickupAvgMs = statPickupNs / (double)pickups / 1e6;
+    s.pickupMaxMs = statPickupMaxNs / 1e6;
+    int queued = (backend == AudioBackend::Device && device) ? bufferCount : 1;
+    s.outputLatencyMs = 1000.0 * blockFrames * queued / rate;
+    if (s.blocks) s.mixAvgUs = statMixNs / (double)s.blocks / 1e3;
+    s.voiceFrames = statVoiceFrames;
+    s.mixTotalMs = statMixNs / 1e6;
+    return s;
+}
@@ -0,0 +1,141 @@
+// audio.h
+// Hop Hop Bunny - sound mixer
+// Sounds are decoded once into 16-bit stereo PCM. A single audio thread mixes every playing
+// voice into small blocks (audio_mix.h kernels; voices whose rate or pitch differs from the
+// output are resampled on the fly) and hands them to a backend (WinMM waveOut, a null sink,
+// or a WAV file). The game thread only pushes play/stop commands into a
+// lock-free single-producer queue, so triggering a sound never touches the disk or a lock.
+
+#pragma once
+
+#include "audio_mix.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decoded sound, interleaved stereo int16.
+struct Sound {
+    int rate = 44100;
+    int frames = 0;
+    std::vector<int16_t> pcm;
+};
+
+// PCM 16-bit mono/stereo RIFF WAVE (other chunks are skipped). Mono is widened to stereo.
+bool parseWav(const unsigned char* data, size_t size, Sound& out);
+bool loadWav(const char* path, Sound& out);
+
+// Writes interleaved stereo int16 as a WAV file.
+bool saveWav(const char* path, const int16_t* pcm, int frames, int rate);
+
+enum class AudioBackend {
+    Device,   // WinMM waveOut on Windows; falls back to Null elsewhere
+    Null,     // mixed in real time, output discarded
+    File,     // mixed in real time, written to a WAV file on shutdown
+    Manual,   // no thread: the caller drives mix() (offline rendering, benchmarks)
+};
+
+struct AudioStats {
+    uint64_t blocks = 0;            // blocks mixed
+    int voicesPeak = 0;             // most voices mixed in one block
+    uint64_t commandsDropped = 0;   // queue was full
+    double pickupAvgMs = 0;         // play() -> voice started in a block
+    double pickupMaxMs = 0;
+    double outputLatencyMs = 0;     // audio queued ahead of the speaker (backend buffers)
+    double mixAvgUs = 0;            // CPU per block
+    uint64_t voiceFrames = 0;       // sum over voices of frames mixed
+    double mixTotalMs = 0;
+};
+
+class AudioEngine {
+public:
+    static const int MAX_VOICES = 256;
+    static const int QUEUE_SIZE = 256;   // power of two
+
+    AudioEngine() {}
+    ~AudioEngine() { shutdown(); }
+
+    AudioEngine(const AudioEngine&) = delete;
+    AudioEngine& operator=(const AudioEngine&) = delete;
+
+    // Register sounds before init(). Returns the sound id, or -1.
+    int addSound(const Sound& s);
+
+    // blockFrames x bufferCount is the output latency (128 x 3 at 44.1 kHz = 8.7 ms).
+    // filePath is only used by the File backend.
+    bool init(AudioBackend backend, int rate = 44100, int blockFrames = 128, int bufferCount = 3,
+        const char* filePath = nullptr);
+    void shutdown();
+
+    // Game thread only (single producer). play() returns a voice handle for stop().
+    // pitch 1 plays at the sound's own rate; anything else is resampled.
+    int play(int sound, float gain = 1.0f, bool loop = false, float pitch = 1.0f);
+    void stop(int voice);
+    void stopAll();
+
+    // Audio thread (or offline caller): apply queued commands and mix the next frames.
+    void mix(int16_t* out, int frames);
+
+    // Kernels used by mix(); init() picks the best the CPU has. Change it only while no
+    // audio thread is running (Manual backend), e.g. to compare paths.
+    void setMixPath(MixPath path) { kern = &mixKernels(path); }
+
+    AudioStats stats() const;
+    int outputRate() const { return rate; }
+    bool running() const { return thread.joinable(); }
+
+private:
+    enum CommandType : uint8_t { CMD_PLAY, CMD_STOP, CMD_STOP_ALL };
+    struct Command {
+        CommandType type;
+        bool loop;
+        int sound;
+        int voice;
+        float gain;
+        float pitch;
+        int64_t issued;              // steady clock ns, for the pickup latency stat
+    };
+    struct Voice {
+        int id = -1;                 // -1: free
+        int sound = 0;
+        uint64_t pos = 0;            // source frame, 32.32 fixed point
+        uint64_t step = 0;           // source frames per output frame, 32.32
+        float gain = 1.0f;
+        bool loop = false;
+    };
+
+    bool push(const Command& c);
+    void drainCommands();
+    void mixBlock(int16_t* out, int frames);
+    void threadMain();
+
+    std::vector<Sound> sounds;
+    int rate = 44100;
+    int blockFrames = 128;
+    int bufferCount = 3;
+    AudioBackend backend = AudioBackend::Null;
+    std::string filePath;
+
+    Command queue[QUEUE_SIZE];
+    std::atomic<uint32_t> queueHead{ 0 };   // written by the audio thread
+    std::atomic<uint32_t> queueTail{ 0 };   // written by the game thread
+    int nextVoiceId = 0;
+
+    Voice voices[MAX_VOICES];               // audio thread only
+    std::vector<float> accum;               // audio thread only, blockFrames * 2
+    const MixKernels* kern = &mixKernels(MixPath::Scalar);
+    std::vector<int16_t> recorded;          // File backend output
+
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+    void* device = nullptr;                 // HWAVEOUT / event HANDLE on Windows
+    void* deviceEvent = nullptr;
+
+    // written by the audio thread, read by stats()
+    std::atomic<uint64_t> statBlocks{ 0 }, statDropped{ 0 }, statPickups{ 0 }, statVoiceFrames{ 0 };
+    std::atomic<int64_t> statPickupNs{ 0 }, statPickupMaxNs{ 0 }, statMixNs{ 0 };
+    std::atomic<int> statVoicesPeak{ 0 };
+};
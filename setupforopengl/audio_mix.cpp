@@ -0,0 +1,199 @@
+// audio_mix.cpp
+// Hop Hop Bunny - mixer inner loops (scalar, SSE2 and NEON paths, dispatch)
+
+#include "audio_mix.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef HHB_X86
+#include <emmintrin.h>
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define HHB_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline float lerpT(uint64_t pos) { return (float)((uint32_t)pos >> 8) * (1.0f / 16777216.0f); }
+
+// ---- scalar reference ----
+
+static void addScalar(float* acc, const int16_t* src, int samples, float gain) {
+    for (int i = 0; i < samples; i++) acc[i] += src[i] * gain;
+}
+
+static uint64_t resampleAddScalar(float* acc, const int16_t* src, uint64_t pos, uint64_t step, int frames, float gain) {
+    for (int f = 0; f < frames; f++, pos += step) {
+        const int16_t* s = src + (pos >> 32) * 2;
+        float t = lerpT(pos);
+        for (int c = 0; c < 2; c++) {
+            float a = s[c], b = s[c + 2];
+            acc[f * 2 + c] += (a + (b - a) * t) * gain;
+        }
+    }
+    return pos;
+}
+
+static void convertScalar(int16_t* out, const float* acc, int samples) {
+    for (int i = 0; i < samples; i++) {
+        float x = std::min(1.0f, std::max(-1.0f, acc[i])) * 32767.0f;
+        out[i] = (int16_t)std::lrint(x);
+    }
+}
+
+static const MixKernels kernelsScalar = { addScalar, resampleAddScalar, convertScalar };
+
+// ---- SSE2 ----
+
+#ifdef HHB_X86
+static inline __m128 s16lo(__m128i v) { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)); }
+static inline __m128 s16hi(__m128i v) { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)); }
+static inline __m128i loadPair(const int16_t* p) { int v; std::memcpy(&v, p, 4); return _mm_cvtsi32_si128(v); }
+
+static void addSSE2(float* acc, const int16_t* src, int samples, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(s16lo(v), g)));
+        _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(s16hi(v), g)));
+    }
+    addScalar(acc + i, src + i, samples - i, gain);
+}
+
+// two output frames (4 samples) per step; each frame needs its (L,R) pair and the next one.
+// SSE2 has no gather, but the fractions are still taken from the 64-bit positions in the vector.
+static uint64_t resampleAddSSE2(float* acc, const int16_t* src, uint64_t pos, uint64_t step, int frames, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    __m128i p = _mm_set_epi64x((long long)(pos + step), (long long)pos);
+    __m128i step2 = _mm_set1_epi64x((long long)(2 * step));
+    __m128i fracMask = _mm_set1_epi64x(0xFFFFFF);
+    __m128 tScale = _mm_set1_ps(1.0f / 16777216.0f);
+    int f = 0;
+    for (; f + 2 <= frames; f += 2) {
+        __m128i hi = _mm_srli_epi64(p, 32);
+        int i0 = _mm_cvtsi128_si32(hi), i1 = _mm_cvtsi128_si32(_mm_unpackhi_epi64(hi, hi));
+        __m128i pa = _mm_unpacklo_epi32(loadPair(src + i0 * 2), loadPair(src + i1 * 2));
+        __m128i pb = _mm_unpacklo_epi32(loadPair(src + i0 * 2 + 2), loadPair(src + i1 * 2 + 2));
+        __m128 a = s16lo(pa), b = s16lo(pb);
+        __m128i frac = _mm_and_si128(_mm_srli_epi64(p, 8), fracMask);
+        __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi32(frac, _MM_SHUFFLE(2, 2, 0, 0))), tScale);
+        __m128 v = _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)), g);
+        _mm_storeu_ps(acc + f * 2, _mm_add_ps(_mm_loadu_ps(acc + f * 2), v));
+        p = _mm_add_epi64(p, step2);
+    }
+    return resampleAddScalar(acc + f * 2, src, pos + (uint64_t)f * step, step, frames - f, gain);
+}
+
+static void convertSSE2(int16_t* out, const float* acc, int samples) {
+    __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), k = _mm_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 x0 = _mm_mul_ps(_mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(acc + i))), k);
+        __m128 x1 = _mm_mul_ps(_mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(acc + i + 4))), k);
+        // cvtps rounds to nearest even like lrint in the default rounding mode
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm_cvtps_epi32(x0), _mm_cvtps_epi32(x1)));
+    }
+    convertScalar(out + i, acc + i, samples - i);
+}
+
+static const MixKernels kernelsSSE2 = { addSSE2, resampleAddSSE2, convertSSE2 };
+#endif
+
+// ---- NEON (AArch64) ----
+
+#ifdef HHB_NEON
+static void addNEON(float* acc, const int16_t* src, int samples, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        // separate mul and add: vmlaq/vfmaq could fuse and break bit-exactness with scalar
+        vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), vmulq_f32(lo, g)));
+        vst1q_f32(acc + i + 4, vaddq_f32(vld1q_f32(acc + i + 4), vmulq_f32(hi, g)));
+    }
+    addScalar(acc + i, src + i, samples - i, gain);
+}
+
+static uint64_t resampleAddNEON(float* acc, const int16_t* src, uint64_t pos, uint64_t step, int frames, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    int f = 0;
+    for (; f + 2 <= frames; f += 2) {
+        uint64_t p0 = pos, p1 = pos + step;
+        int16_t a[4], b[4];
+        std::memcpy(a, src + (p0 >> 32) * 2, 4); std::memcpy(b, src + (p0 >> 32) * 2 + 2, 4);
+        std::memcpy(a + 2, src + (p1 >> 32) * 2, 4); std::memcpy(b + 2, src + (p1 >> 32) * 2 + 2, 4);
+        float32x4_t va = vcvtq_f32_s32(vmovl_s16(vld1_s16(a)));
+        float32x4_t vb = vcvtq_f32_s32(vmovl_s16(vld1_s16(b)));
+        float t0 = lerpT(p0), t1 = lerpT(p1);
+        const float tt[4] = { t0, t0, t1, t1 };
+        float32x4_t v = vmulq_f32(vaddq_f32(va, vmulq_f32(vsubq_f32(vb, va), vld1q_f32(tt))), g);
+        vst1q_f32(acc + f * 2, vaddq_f32(vld1q_f32(acc + f * 2), v));
+        pos += 2 * step;
+    }
+    return resampleAddScalar(acc + f * 2, src, pos, step, frames - f, gain);
+}
+
+static void convertNEON(int16_t* out, const float* acc, int samples) {
+    float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f), k = vdupq_n_f32(32767.0f);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        float32x4_t x0 = vmulq_f32(vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(acc + i))), k);
+        float32x4_t x1 = vmulq_f32(vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(acc + i + 4))), k);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(x0)), vqmovn_s32(vcvtnq_s32_f32(x1))));
+    }
+    convertScalar(out + i, acc + i, samples - i);
+}
+
+static const MixKernels kernelsNEON = { addNEON, resampleAddNEON, convertNEON };
+#endif
+
+// ---- dispatch ----
+
+bool mixPathAvailable(MixPath path) {
+    switch (path) {
+    case MixPath::Scalar: return true;
+#ifdef HHB_X86
+    case MixPath::SSE2: return true;
+    case MixPath::AVX2: { static const bool has = mixAVX2Built() && cpuHasAVX2(); return has; }
+#endif
+#ifdef HHB_NEON
+    case MixPath::NEON: return true;
+#endif
+    default: return false;
+    }
+}
+
+MixPath mixBestPath() {
+    if (mixPathAvailable(MixPath::AVX2)) return MixPath::AVX2;
+    if (mixPathAvailable(MixPath::SSE2)) return MixPath::SSE2;
+    if (mixPathAvailable(MixPath::NEON)) return MixPath::NEON;
+    return MixPath::Scalar;
+}
+
+const char* mixPathName(MixPath path) {
+    switch (path) {
+    case MixPath::SSE2: return "sse2";
+    case MixPath::AVX2: return "avx2";
+    case MixPath::NEON: return "neon";
+    default: return "scalar";
+    }
+}
+
+const MixKernels& mixKernels(MixPath path) {
+    if (!mixPathAvailable(path)) return kernelsScalar;
+    switch (path) {
+#ifdef HHB_X86
+    case MixPath::SSE2: return kernelsSSE2;
+    case MixPath::AVX2: return mixKernelsAVX2();
+#endif
+#ifdef HHB_NEON
+    case MixPath::NEON: return kernelsNEON;
+#endif
+    default: return kernelsScalar;
+    }
+}
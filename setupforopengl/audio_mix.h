@@ -0,0 +1,35 @@
+// audio_mix.h
+// Hop Hop Bunny - mixer inner loops
+// The three loops the mixer spends its time in: add a voice into the float accumulator
+// (straight or resampled with linear interpolation) and convert the accumulator to int16.
+// Buffers are interleaved stereo. Every path does the same float operations in the same
+// order (no FMA), so scalar, SSE2, AVX2 and NEON output is bit-identical.
+
+#pragma once
+
+#include <cstdint>
+
+enum class MixPath { Scalar, SSE2, AVX2, NEON };
+
+struct MixKernels {
+    // acc[i] += src[i] * gain for samples values (gain already includes 1/32768)
+    void (*add)(float* acc, const int16_t* src, int samples, float gain);
+
+    // For each of frames output frames: source position pos (32.32 fixed, in frames), linear
+    // interpolation between frame pos>>32 and the next one, added to acc with gain; pos then
+    // advances by step. The caller keeps the last position read below the sound's last frame.
+    // Returns the position after the last frame.
+    uint64_t (*resampleAdd)(float* acc, const int16_t* src, uint64_t pos, uint64_t step, int frames, float gain);
+
+    // out[i] = round(clamp(acc[i], -1, 1) * 32767)
+    void (*convert)(int16_t* out, const float* acc, int samples);
+};
+
+bool mixPathAvailable(MixPath path);
+MixPath mixBestPath();
+const char* mixPathName(MixPath path);
+const MixKernels& mixKernels(MixPath path);   // falls back to scalar if the path is unavailable
+
+// implemented per instruction set (audio_mix.cpp, audio_mix_avx2.cpp)
+bool mixAVX2Built();
+const MixKernels& mixKernelsAVX2();
@@ -0,0 +1,95 @@
+// audio_mix_avx2.cpp
+// Hop Hop Bunny - AVX2 path of the mixer inner loops.
+// This file alone is compiled with AVX2 enabled (-mavx2, or /arch:AVX2 per file in VS);
+// it is only called after mixPathAvailable(MixPath::AVX2) said the CPU has it.
+
+#include "audio_mix.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static inline float lerpT(uint64_t pos) { return (float)((uint32_t)pos >> 8) * (1.0f / 16777216.0f); }
+
+// tails go through the same scalar expressions as the reference path
+static void addTail(float* acc, const int16_t* src, int samples, float gain) {
+    for (int i = 0; i < samples; i++) acc[i] += src[i] * gain;
+}
+
+static void addAVX2(float* acc, const int16_t* src, int samples, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(lo, g)));
+        _mm256_storeu_ps(acc + i + 8, _mm256_add_ps(_mm256_loadu_ps(acc + i + 8), _mm256_mul_ps(hi, g)));
+    }
+    addTail(acc + i, src + i, samples - i, gain);
+}
+
+// four output frames per step: each stereo frame is one 32-bit (L,R) pair, so the frames at
+// pos>>32 and the one after are two 32-bit gathers. Positions stay 64-bit in the vector; the
+// fraction is the same 24 bits lerpT() takes, so t is bit-identical to the scalar path.
+static uint64_t resampleAddAVX2(float* acc, const int16_t* src, uint64_t pos, uint64_t step, int frames, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    const int* pairs = (const int*)src;
+    __m256i p = _mm256_set_epi64x((long long)(pos + 3 * step), (long long)(pos + 2 * step), (long long)(pos + step), (long long)pos);
+    __m256i step4 = _mm256_set1_epi64x((long long)(4 * step));
+    __m256i fracMask = _mm256_set1_epi64x(0xFFFFFF);
+    __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256i evensDup = _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6);
+    __m256 tScale = _mm256_set1_ps(1.0f / 16777216.0f);
+    int f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128i idx = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_srli_epi64(p, 32), evens));
+        __m128i ga = _mm_i32gather_epi32(pairs, idx, 4);
+        __m128i gb = _mm_i32gather_epi32(pairs + 1, idx, 4);
+        __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(ga));
+        __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(gb));
+        __m256i frac = _mm256_and_si256(_mm256_srli_epi64(p, 8), fracMask);
+        __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_permutevar8x32_epi32(frac, evensDup)), tScale);
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t)), g);
+        _mm256_storeu_ps(acc + f * 2, _mm256_add_ps(_mm256_loadu_ps(acc + f * 2), v));
+        p = _mm256_add_epi64(p, step4);
+    }
+    pos += (uint64_t)f * step;
+    for (; f < frames; f++, pos += step) {
+        const int16_t* s = src + (pos >> 32) * 2;
+        float t = lerpT(pos);
+        for (int c = 0; c < 2; c++) {
+            float a = s[c], b = s[c + 2];
+            acc[f * 2 + c] += (a + (b - a) * t) * gain;
+        }
+    }
+    return pos;
+}
+
+static void convertAVX2(int16_t* out, const float* acc, int samples) {
+    __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f), k = _mm256_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256 x0 = _mm256_mul_ps(_mm256_min_ps(hi, _mm256_max_ps(lo, _mm256_loadu_ps(acc + i))), k);
+        __m256 x1 = _mm256_mul_ps(_mm256_min_ps(hi, _mm256_max_ps(lo, _mm256_loadu_ps(acc + i + 8))), k);
+        // packs works per 128-bit lane; put the quarters back in order
+        __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(x0), _mm256_cvtps_epi32(x1));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+    for (; i < samples; i++) {
+        __m128 x = _mm_mul_ss(_mm_min_ss(_mm_set_ss(1.0f), _mm_max_ss(_mm_set_ss(-1.0f), _mm_set_ss(acc[i]))), _mm_set_ss(32767.0f));
+        out[i] = (int16_t)_mm_cvtss_si32(x);
+    }
+}
+
+static const MixKernels kernelsAVX2 = { addAVX2, resampleAddAVX2, convertAVX2 };
+
+bool mixAVX2Built() { return true; }
+const MixKernels& mixKernelsAVX2() { return kernelsAVX2; }
+
+#else
+
+// built without AVX2 support: never selected at runtime, but keep the symbol
+bool mixAVX2Built() { return false; }
+const MixKernels& mixKernelsAVX2() { return mixKernels(MixPath::Scalar); }
+
+#endif
@@ -0,0 +1,210 @@
+// bake_assets.cpp
+// Hop Hop Bunny - offline asset baker
+// Decodes every image in asset_manifest.h, packs each group into atlas pages exactly like the
+// runtime loader does, and writes them together with the sounds to one archive (asset_pack.h).
+// Run it from the game's working directory whenever an image or sound changes; the game uses
+// assets.pak when it is present and complete, and falls back to the loose PNGs otherwise.
+//
+// Build (Linux):  g++ -O2 -std=c++17 -Idependencies/include bake_assets.cpp atlas.cpp asset_pack.cpp -o bake_assets
+// Usage:          ./bake_assets [--out assets.pak] [--page-size 4096]
+
+#include "asset_manifest.h"
+#include "asset_pack.h"
+#include "atlas.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static bool readFile(const char* path, std::vector<unsigned char>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out.resize(n > 0 ? (size_t)n : 0);
+    bool ok = n > 0 && fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+// Records which file an entry was baked from, for AssetPack::sourceChanged().
+static void stampSource(PackEntry& e, const char* path, const std::vector<unsigned char>& bytes) {
+    e.srcSize = bytes.size();
+    uint64_t size = 0;
+    packSourceStat(path, size, e.srcMtime);
+    e.srcHash = packHashBytes(bytes.data(), bytes.size());
+}
+
+// Entries plus the payload bytes they point at, laid out in file order.
+struct PackBuilder {
+    std::vector<PackEntry> entries;
+    std::string names;
+    std::vector<const unsigned char*> payload;
+    std::vector<std::vector<unsigned char>> payloadOwned;   // sounds read from disk
+
+    int add(uint32_t type, int group, const char* name, const void* data, size_t size) {
+        PackEntry e;
+        std::memset(&e, 0, sizeof(e));
+        e.type = type;
+        e.group = group;
+        e.name = PACK_NO_NAME;
+        e.page = -1;
+        e.size = size;
+        if (name) {
+            e.name = (uint32_t)names.size();
+            names.append(name);
+            names.push_back('\0');
+        }
+        entries.push_back(e);
+        payload.push_back((const unsigned char*)data);
+        return (int)entries.size() - 1;
+    }
+
+    bool write(const char* path) {
+        uint64_t off = sizeof(PackHeader) + entries.size() * sizeof(PackEntry) + names.size();
+        for (PackEntry& e : entries) {
+            if (!e.size) { e.offset = 0; continue; }
+            off = (off + PACK_ALIGN - 1) & ~(uint64_t)(PACK_ALIGN - 1);
+            e.offset = off;
+            off += e.size;
+        }
+
+        PackHeader h;
+        std::memcpy(h.magic, PACK_MAGIC, 4);
+        h.version = PACK_VERSION;
+        h.entryCount = (uint32_t)entries.size();
+        h.namesSize = (uint32_t)names.size();
+        h.fileSize = off;
+
+        // written next to the target and renamed, so a running game never maps half a file
+        std::string tmp = std::string(path) + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) { fprintf(stderr, "Cannot write %s\n", tmp.c_str()); return false; }
+        fwrite(&h, sizeof(h), 1, f);
+        fwrite(entries.data(), sizeof(PackEntry), entries.size(), f);
+        fwrite(names.data(), 1, names.size(), f);
+        static const unsigned char zeros[PACK_ALIGN] = {};
+        uint64_t pos = sizeof(PackHeader) + entries.size() * sizeof(PackEntry) + names.size();
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].size) continue;
+            fwrite(zeros, 1, (size_t)(entries[i].offset - pos), f);
+            fwrite(payload[i], 1, (size_t)entries[i].size, f);
+            pos = entries[i].offset + entries[i].size;
+        }
+        bool ok = !ferror(f);
+        ok = (fclose(f) == 0) && ok;
+        if (ok) {
+            remove(path);
+            ok = rename(tmp.c_str(), path) == 0;
+        }
+        if (!ok) fprintf(stderr, "Failed writing %s\n", path);
+        return ok;
+    }
+};
+
+int main(int argc, char** argv) {
+    const char* outPath = "assets.pak";
+    int pageSize = 4096;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else if (!strcmp(argv[i], "--page-size") && i + 1 < argc) pageSize = atoi(argv[++i]);
+        else { fprintf(stderr, "Unknown option: %s\n", argv[i]); return 1; }
+    }
+
+    // decode the same way the game does (rows bottom-up)
+    auto t0 = Clock::now();
+    stbi_set_flip_vertically_on_load(1);
+    std::vector<AtlasImage> images(ASSET_IMAGE_COUNT);
+    std::vector<PackEntry> sources(ASSET_IMAGE_COUNT);   // only the src* fields
+    size_t pngBytes = 0;
+    for (int i = 0; i < ASSET_IMAGE_COUNT; i++) {
+        AtlasImage& img = images[i];
+        img.name = ASSET_IMAGES[i].path;
+        std::vector<unsigned char> file;
+        if (!readFile(img.name.c_str(), file)) { fprintf(stderr, "Failed load: %s\n", img.name.c_str()); return 1; }
+        pngBytes += file.size();
+        stampSource(sources[i], img.name.c_str(), file);
+        int tc = 0;
+        unsigned char* d = stbi_load_from_memory(file.data(), (int)file.size(), &img.w, &img.h, &tc, 4);
+        if (!d) { fprintf(stderr, "Failed decode: %s\n", img.name.c_str()); return 1; }
+        img.rgba.assign(d, d + (size_t)img.w * img.h * 4);
+        stbi_image_free(d);
+    }
+    double decodeMs = msSince(t0);
+
+    PackBuilder pack;
+    std::vector<Atlas> atlases(ASSET_GROUP_COUNT);
+    for (int g = 0; g < ASSET_GROUP_COUNT; g++) {
+        std::vector<const AtlasImage*> group;
+        std::vector<int> groupImages;
+        for (int i = 0; i < ASSET_IMAGE_COUNT; i++) {
+            if (ASSET_IMAGES[i].group != g) continue;
+            group.push_back(&images[i]);
+            groupImages.push_back(i);
+        }
+        if (!packAtlas(group, pageSize, atlases[g])) { fprintf(stderr, "Atlas packing failed for group %d\n", g); return 1; }
+
+        std::vector<int> pageEntry;
+        for (const AtlasPage& pg : atlases[g].pages) {
+            int e = pack.add(PACK_PAGE, g, nullptr, pg.rgba.data(), pg.rgba.size());
+            pack.entries[e].w = pg.w;
+            pack.entries[e].h = pg.h;
+            pageEntry.push_back(e);
+        }
+        for (size_t i = 0; i < group.size(); i++) {
+            const AtlasSprite& a = atlases[g].sprites[i];
+            if (a.page < 0) { fprintf(stderr, "Skipping empty image: %s\n", group[i]->name.c_str()); continue; }
+            int e = pack.add(PACK_SPRITE, g, group[i]->name.c_str(), nullptr, 0);
+            PackEntry& s = pack.entries[e];
+            s.page = pageEntry[a.page];
+            s.w = a.w; s.h = a.h;
+            s.u0 = a.u0; s.v0 = a.v0; s.u1 = a.u1; s.v1 = a.v1;
+            s.fx0 = a.fx0; s.fy0 = a.fy0; s.fx1 = a.fx1; s.fy1 = a.fy1;
+            const PackEntry& src = sources[groupImages[i]];
+            s.srcSize = src.srcSize; s.srcMtime = src.srcMtime; s.srcHash = src.srcHash;
+        }
+        printf("group %d: %zu images -> %zu page(s), %.1f MB\n", g, group.size(), atlases[g].pages.size(),
+            atlasBytes(atlases[g]) / (1024.0 * 1024.0));
+    }
+
+    for (int i = 0; i < ASSET_SOUND_COUNT; i++) {
+        std::vector<unsigned char> wav;
+        if (!readFile(ASSET_SOUNDS[i], wav)) { fprintf(stderr, "Failed load: %s\n", ASSET_SOUNDS[i]); return 1; }
+        int e = pack.add(PACK_SOUND, -1, ASSET_SOUNDS[i], wav.data(), wav.size());
+        stampSource(pack.entries[e], ASSET_SOUNDS[i], wav);
+        pack.payloadOwned.push_back(std::move(wav));   // moving keeps the buffer where it is
+    }
+
+    if (!pack.write(outPath)) return 1;
+
+    // what the game pays at startup with the pack: map it and touch every page once
+    auto t1 = Clock::now();
+    AssetPack check;
+    if (!check.open(outPath)) { fprintf(stderr, "Baked pack does not validate\n"); return 1; }
+    unsigned sum = 0;
+    for (int i = 0; i < check.count(); i++) {
+        const PackEntry& e = check.entry(i);
+        if (e.type != PACK_PAGE) continue;
+        const unsigned char* p = check.data(e);
+        for (uint64_t b = 0; b < e.size; b += 4096) sum += p[b];
+    }
+    double mapMs = msSince(t1);
+
+    printf("%s: %d entries, %.1f MB (from %d PNGs, %.1f MB on disk)\n", outPath, check.count(),
+        check.fileSize() / (1024.0 * 1024.0), ASSET_IMAGE_COUNT, pngBytes / (1024.0 * 1024.0));
+    printf("PNG read+decode: %.1f ms, pack map+touch: %.1f ms (warm cache) [%u]\n", decodeMs, mapMs, sum & 1);
+    return 0;
+}
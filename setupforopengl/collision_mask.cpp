@@ -0,0 +1,85 @@
+// collision_mask.cpp
+// Hop Hop Bunny - pixel hitbox from sprite alpha
+
+#include "collision_mask.h"
+
+#include <cmath>
+#include <vector>
+
+void CollisionMask::addSprite(const unsigned char* rgba, int stride, int x, int y, int w, int h,
+    float fx0, float fy0, float fx1, float fy1) {
+    if (!rgba || w <= 0 || h <= 0 || fx1 <= fx0 || fy1 <= fy0) return;
+
+    // source pixels across the whole (untrimmed) frame
+    const double frameW = w / (double)(fx1 - fx0), frameH = h / (double)(fy1 - fy0);
+    std::vector<uint32_t> alpha(SIZE * SIZE, 0);
+    for (int py = 0; py < h; py++) {
+        const unsigned char* row = rgba + ((size_t)(y + py) * stride + x) * 4;
+        double fy = fy0 + (py + 0.5) / frameH;
+        int r = SIZE - 1 - (int)(fy * SIZE);   // rows are bottom-up, mask rows top-down
+        if (r < 0 || r >= SIZE) continue;
+        for (int px = 0; px < w; px++) {
+            unsigned a = row[px * 4 + 3];
+            if (!a) continue;
+            int c = (int)((fx0 + (px + 0.5) / frameW) * SIZE);
+            if (c >= 0 && c < SIZE) alpha[r * SIZE + c] += a;
+        }
+    }
+
+    const double half = 127.5 * (frameW / SIZE) * (frameH / SIZE);   // half of a fully opaque cell
+    for (int r = 0; r < SIZE; r++) {
+        for (int c = 0; c < SIZE; c++) {
+            if (alpha[r * SIZE + c] >= half) rows[r] |= 1ull << c;
+        }
+    }
+}
+
+void CollisionMask::finish() {
+    uint64_t acc = 0;
+    for (int r = 0; r < SIZE; r++) { acc |= rows[r]; fromTop[r] = acc; }
+    acc = 0;
+    for (int r = SIZE - 1; r >= 0; r--) { acc |= rows[r]; fromBottom[r] = acc; }
+
+    solidCells = 0;
+    int top = SIZE, bottom = -1, left = SIZE, right = -1;
+    for (int r = 0; r < SIZE; r++) {
+        for (int c = 0; c < SIZE; c++) {
+            if (!(rows[r] >> c & 1)) continue;
+            solidCells++;
+            if (r < top) top = r;
+            if (r > bottom) bottom = r;
+            if (c < left) left = c;
+            if (c > right) right = c;
+        }
+    }
+
+    const float cellW = 2.0f * halfW / SIZE, cellH = 2.0f * halfH / SIZE;
+    invCellW = cellW > 0.0f ? 1.0f / cellW : 0.0f;
+    invCellH = cellH > 0.0f ? 1.0f / cellH : 0.0f;
+    if (!solidCells) { extLeft = extRight = extTop = extBottom = 0.0f; return; }
+    extLeft = halfW - left * cellW;
+    extRight = (right + 1) * cellW - halfW;
+    extTop = halfH - top * cellH;
+    extBottom = (bottom + 1) * cellH - halfH;
+}
+
+bool CollisionMask::hitsPipe(float cx, float cy, float pl, float pr, float gb, float gt) const {
+    // columns under the pipe
+    const float left = cx - halfW;
+    float a = (pl - left) * invCellW, b = (pr - left) * invCellW;
+    if (b < 0.0f || a >= (float)SIZE) return false;
+    int c0 = a < 0.0f ? 0 : (int)a;
+    int c1 = b >= (float)SIZE ? SIZE - 1 : (int)b;
+    uint64_t cols = (~0ull >> (SIZE - 1 - c1)) & (~0ull << c0);
+
+    // rows 0..ceil(nt)-1 reach above the gap top, rows floor(nb).. reach below its bottom
+    const float top = cy + halfH;
+    float nt = (top - gt) * invCellH, nb = (top - gb) * invCellH;
+    uint64_t solid = 0;
+    if (nt > 0.0f) {
+        int n = nt >= (float)SIZE ? SIZE : (int)std::ceil(nt);
+        solid |= fromTop[n - 1];
+    }
+    if (nb < (float)SIZE) solid |= fromBottom[nb <= 0.0f ? 0 : (int)nb];
+    return (solid & cols) != 0;
+}
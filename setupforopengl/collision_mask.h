@@ -0,0 +1,41 @@
+// collision_mask.h
+// Hop Hop Bunny - pixel hitbox from sprite alpha
+// The sprite frame is cut into a SIZE x SIZE grid and a cell counts as solid when the sprite
+// covers at least half of it (alpha summed over the cell's pixels). Each row is one 64-bit
+// word, so a pipe test is: the columns under the pipe as a bit range, the rows above the gap
+// top (always a run from the top of the frame) and the rows below the gap bottom (a run to
+// the bottom), looked up as prefix ORs. Two loads and an AND, however the pipe lies.
+// No GL here: the sim and the headless runner use it too.
+
+#pragma once
+
+#include <cstdint>
+
+struct CollisionMask {
+    static const int SIZE = 64;                 // cells per side, one uint64_t per row
+
+    float halfW = 0.0f, halfH = 0.0f;           // NDC half size of the frame, centred on the bird
+    uint64_t rows[SIZE] = {};                   // row 0 at the top, bit c = column c from the left
+
+    // filled by finish()
+    uint64_t fromTop[SIZE] = {};                // rows 0..r OR'ed together
+    uint64_t fromBottom[SIZE] = {};             // rows r..SIZE-1 OR'ed together
+    float extLeft = 0, extRight = 0, extTop = 0, extBottom = 0;   // solid cells' reach from the centre
+    float invCellW = 0, invCellH = 0;
+    int solidCells = 0;
+
+    // ORs a sprite's solid cells into rows. rgba is RGBA8 with rows bottom-up and stride pixels
+    // per row; (x, y, w, h) is the sprite's rect in it, which sits at [fx0,fx1] x [fy0,fy1]
+    // (y up) of the frame: atlas sprites are trimmed, a whole image is 0..1. Adding several
+    // frames gives their union.
+    void addSprite(const unsigned char* rgba, int stride, int x, int y, int w, int h,
+        float fx0, float fy0, float fx1, float fy1);
+
+    // Call after the last addSprite() and whenever halfW/halfH change.
+    void finish();
+    bool empty() const { return solidCells == 0; }
+
+    // Frame centred on (cx, cy) against a pipe column [pl, pr] that is solid outside the gap
+    // (gb, gt).
+    bool hitsPipe(float cx, float cy, float pl, float pr, float gb, float gt) const;
+};
@@ -2,6 +2,7 @@
 // Hop Hop Bunny - Final Polish
 // Fixed: "Best Score" text is now responsive (scales with screen) and much larger.
 
+#define NOMINMAX
 #include <windows.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,55 +11,76 @@
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include <mmsystem.h>
-#pragma comment(lib, "winmm.lib")
+#include <cstring>
+
+#include "asset_loader.h"
+#include "asset_manifest.h"
+#include "asset_pack.h"
+#include "atlas.h"
+#include "audio.h"
+#include "alloc_hook.h"
+#include "frame_pacer.h"
+#include "game_sim.h"
+#include "gpu_timer.h"
+#include "latency_meter.h"
+#include "profiler.h"
+#include "replay.h"
+#include "sprite_batch.h"
+#include "work_pool.h"
 
 using Clock = std::chrono::high_resolution_clock;
 
+// Pipe shaders: one instance per pipe half, centre/size/colour come from the instance buffer
 const char* vertexSrc = R"glsl(
 #version 330 core
 layout(location=0) in vec2 aPos;
-uniform vec2 uPos;
-uniform vec2 uScale;
+layout(location=1) in vec2 iCenter;
+layout(location=2) in vec2 iSize;
+layout(location=3) in vec3 iColor;
+out vec3 vColor;
 void main() {
-    vec2 pos = aPos * uScale + uPos;
+    vColor = iColor;
+    vec2 pos = aPos * iSize + iCenter;
     gl_Position = vec4(pos,0,1);
 }
 )glsl";
 
 const char* fragSrc = R"glsl(
 #version 330 core
+in vec3 vColor;
 out vec4 FragColor;
-uniform vec3 uColor;
-void main(){ FragColor = vec4(uColor,1.0); }
+void main(){ FragColor = vec4(vColor,1.0); }
 )glsl";
 
+// Sprite batch shaders: positions are already in NDC, alpha comes per vertex
 const char* texV = R"glsl(
 #version 330 core
 layout(location=0) in vec2 aPos;
 layout(location=1) in vec2 aUV;
+layout(location=2) in float aAlpha;
 out vec2 vUV;
-uniform vec2 uPos;
-uniform vec2 uScale;
+out float vAlpha;
 void main() {
     vUV = aUV;
-    vec2 pos = aPos * uScale + uPos;
-    gl_Position = vec4(pos,0,1);
+    vAlpha = aAlpha;
+    gl_Position = vec4(aPos,0,1);
 }
 )glsl";
 
 const char* texF = R"glsl(
 #version 330 core
 in vec2 vUV;
+in float vAlpha;
 out vec4 FragColor;
 uniform sampler2D uTex;
-uniform float uAlpha;
 void main() {
     FragColor = texture(uTex,vUV);
-    FragColor.a *= uAlpha;
+    FragColor.a *= vAlpha;
 }
 )glsl";
 
@@ -93,20 +115,76 @@ GLuint linkProgram(const char* vs, const char* fs) {
 
 // Quad data (NDC unit quad centered at origin)
 float rectVerts[] = { -0.5f,-0.5f, 0.5f,-0.5f, 0.5f,0.5f, -0.5f,-0.5f, 0.5f,0.5f, -0.5f,0.5f };
-float quad[] = {
-    -0.5f,-0.5f, 0.0f,0.0f, 0.5f,-0.5f, 1.0f,0.0f, 0.5f,0.5f,1.0f,1.0f,
-    -0.5f,-0.5f,0.0f,0.0f, 0.5f,0.5f,1.0f,1.0f, -0.5f,0.5f,0.0f,1.0f
-};
 
-struct Pipe { float x; float gapY; float width; float gapSize; bool scored = false; };
-struct UIButton { float x, y, w, h; GLuint tex = 0; bool visible = true; std::function<void()> onClick; };
-struct Cloud { float x_px, y_px, speed; GLuint tex; float w_px, h_px; };
+struct UIButton { float x, y, w, h; Sprite tex; bool visible = true; std::function<void()> onClick; };
+struct Cloud { float x_px, y_px, speed; Sprite tex; float w_px, h_px; };
+
+// Decimal digits of v >= 0, most significant first. Returns the count (at most 10).
+static int toDigits(int v, int out[10]) {
+    int tmp[10], n = 0;
+    do { tmp[n++] = v % 10; v /= 10; } while (v > 0 && n < 10);
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+}
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-int main() {
+int main(int argc, char** argv) {
     const int WIN_W = 1280, WIN_H = 720;
+    auto processStart = Clock::now();
+
+    // Command line
+    GameParams params;
+    AudioBackend audioBackend = AudioBackend::Device;
+    const char* audioFile = nullptr;
+    bool showProfile = false;
+    int allocCheck = 0;
+    bool haveSeed = false;
+    uint32_t courseSeed = 0;
+    const char* tracePath = nullptr;
+    const char* recordPath = nullptr;
+    const char* playPath = nullptr;
+    PresentMode presentMode = PresentMode::Vsync;
+    double fpsCap = 0.0;
+    int spinUs = 2000;
+    const char* latencyPath = nullptr;
+    LatencyMeter latency;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stress") == 0) {
+            // thousands of thin pipes on screen, and nothing can end the run; with --profile the
+            // exit summary shows collision staying flat while scroll grows with the pipe count
+            params.spawnInterval = 0.003f;
+            params.pipeWidth = 0.004f;
+            params.godMode = true;
+        }
+        else if (strcmp(argv[i], "--audio-null") == 0) audioBackend = AudioBackend::Null;
+        else if (strcmp(argv[i], "--audio-file") == 0 && i + 1 < argc) { audioBackend = AudioBackend::File; audioFile = argv[++i]; }
+        else if (strcmp(argv[i], "--profile") == 0) showProfile = true;   // same as pressing F3
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];   // Chrome trace JSON on exit
+        else if (strcmp(argv[i], "--alloc-check") == 0 && i + 1 < argc) allocCheck = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) { haveSeed = true; courseSeed = (uint32_t)strtoul(argv[++i], nullptr, 10); }   // same course every run
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];   // replay file of each run, the last one kept
+        else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) playPath = argv[++i];       // play a replay file, no flaps from the window
+        else if (strcmp(argv[i], "--present") == 0 && i + 1 < argc) {   // vsync (default), uncapped, capped, adaptive
+            if (!parsePresentMode(argv[++i], presentMode)) std::cerr << "Unknown present mode: " << argv[i] << "\n";
+        }
+        else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) { presentMode = PresentMode::Capped; fpsCap = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--spin-us") == 0 && i + 1 < argc) spinUs = atoi(argv[++i]);   // capped: spin this long before each frame, 0 = sleep only
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) { latency.measuring = true; latencyPath = argv[++i]; }   // input-to-photon histogram CSV
+        else if (strcmp(argv[i], "--gpu-drain") == 0) latency.drainGpu = true;   // glFinish after every swap
+        else { std::cerr << "Unknown option: " << argv[i] << "\n"; }
+    }
+
+    // A replay brings its own seed and params (hitbox included); they replace the command line's.
+    Replay playback;
+    if (playPath) {
+        if (!loadReplay(playPath, playback)) return -1;
+        haveSeed = true;
+        courseSeed = playback.seed;
+    }
+    ReplayWriter recorder;   // streams each run to recordPath; no thread until the first begin()
+
     if (!glfwInit()) { std::cerr << "GLFW init failed\n"; return -1; }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -117,40 +195,76 @@ int main() {
     glfwMakeContextCurrent(win);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { std::cerr << "GLAD init failed\n"; return -1; }
 
-    // Play lobby music (looping)
-    PlaySound(TEXT("lobby.wav"), nullptr, SND_FILENAME | SND_ASYNC | SND_LOOP);
+    // Present mode: always set explicitly, the driver default varies. --alloc-check runs uncapped.
+    FramePacer pacer;
+    if (allocCheck > 0) presentMode = PresentMode::Uncapped;
+    if (presentMode == PresentMode::Capped && fpsCap <= 0.0) fpsCap = 60.0;
+    pacer.init(presentMode, fpsCap, spinUs);
+    if (pacer.mode() == PresentMode::Adaptive &&
+        !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        std::cerr << "Adaptive vsync not supported, using vsync\n";
+        pacer.useVsync();
+    }
+    glfwSwapInterval(pacer.swapInterval());
 
 
     // Programs
     GLuint prog = linkProgram(vertexSrc, fragSrc);
-    GLint locPos = glGetUniformLocation(prog, "uPos");
-    GLint locScale = glGetUniformLocation(prog, "uScale");
-    GLint locColor = glGetUniformLocation(prog, "uColor");
 
-    GLuint vao, vbo; glGenVertexArrays(1, &vao); glGenBuffers(1, &vbo);
+    // pipe instances: center(2) size(2) color(3), refilled once per frame
+    const int PIPE_INST_FLOATS = 7;
+    std::vector<float> pipeInstances;
+    GLsizeiptr pipeInstCapacity = 0;
+
+    GLuint vao, vbo, vboInst; glGenVertexArrays(1, &vao); glGenBuffers(1, &vbo); glGenBuffers(1, &vboInst);
     glBindVertexArray(vao); glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(rectVerts), rectVerts, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0); glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, vboInst);
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, PIPE_INST_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, PIPE_INST_FLOATS * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(3); glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, PIPE_INST_FLOATS * sizeof(float), (void*)(4 * sizeof(float)));
+    glVertexAttribDivisor(1, 1); glVertexAttribDivisor(2, 1); glVertexAttribDivisor(3, 1);
     glBindVertexArray(0);
 
+    // draws rects (PIPE_INST_FLOATS each) from the streaming instance buffer in one call
+    auto drawRects = [&](const std::vector<float>& inst) {
+        if (inst.empty()) return;
+        GLsizeiptr bytes = (GLsizeiptr)(inst.size() * sizeof(float));
+        glBindBuffer(GL_ARRAY_BUFFER, vboInst);
+        if (bytes > pipeInstCapacity) pipeInstCapacity = bytes * 2;
+        glBufferData(GL_ARRAY_BUFFER, pipeInstCapacity, nullptr, GL_STREAM_DRAW);   // orphan the previous contents
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, inst.data());
+
+        glUseProgram(prog);
+        glBindVertexArray(vao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)(inst.size() / PIPE_INST_FLOATS));
+        };
+
     GLuint texProg = linkProgram(texV, texF);
-    GLint texLocPos = glGetUniformLocation(texProg, "uPos");
-    GLint texLocScale = glGetUniformLocation(texProg, "uScale");
-    GLint texLocTex = glGetUniformLocation(texProg, "uTex");
-    GLint texLocAlpha = glGetUniformLocation(texProg, "uAlpha");
-
-    GLuint vaoTex, vboTex; glGenVertexArrays(1, &vaoTex); glGenBuffers(1, &vboTex);
-    glBindVertexArray(vaoTex); glBindBuffer(GL_ARRAY_BUFFER, vboTex);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glBindVertexArray(0);
+    SpriteBatch sprites;
+    sprites.init(texProg);
+    GpuTimer gpuTimer;
+    gpuTimer.init();
+
+    // Images come from assets.pak (bake_assets.cpp) when it is there: atlas pages are mapped
+    // and uploaded as-is, no PNG decode. Otherwise they are decoded on the worker pool and
+    // packed into atlas pages (atlas.h) per group. Either way the title screen group is waited
+    // for before the first frame and the gameplay group streams in while the title screen is
+    // already up. Sprites stay empty (and are skipped) until then.
+    WorkPool pool;
+    AssetLoader loader(pool, ASSET_GROUP_COUNT);
+    AssetPack pack;
+    bool usePack = pack.open("assets.pak");
+    std::vector<std::string> imagePaths;
+    std::vector<Sprite*> imageTargets;
+    auto loadTex = [&](const char* path, Sprite& dst) {
+        if (assetImageGroup(path) < 0) { std::cerr << "Not in asset_manifest.h, skipped: " << path << "\n"; return; }
+        imagePaths.push_back(path);
+        imageTargets.push_back(&dst);
+        };
 
-    auto loadTex = [&](const char* path, int* out_w = nullptr, int* out_h = nullptr)->GLuint {
-        int tw = 0, th = 0, tc = 0;
-        stbi_set_flip_vertically_on_load(1);
-        unsigned char* d = stbi_load(path, &tw, &th, &tc, 4);
-        if (!d) { std::cerr << "Failed load: " << path << "\n"; return 0; }
+    auto uploadTex = [&](int tw, int th, const unsigned char* d)->GLuint {
         GLuint t; glGenTextures(1, &t); glBindTexture(GL_TEXTURE_2D, t);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -158,8 +272,6 @@ int main() {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0, GL_RGBA, GL_UNSIGNED_BYTE, d);
         glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(d);
-        if (out_w)*out_w = tw; if (out_h)*out_h = th;
         return t;
         };
 
@@ -174,80 +286,194 @@ int main() {
     resetBtn.visible = false;
 
     // Load textures
-    startBtn.tex = loadTex("buttons/START button.png");
-    resetBtn.tex = loadTex("buttons/RESET button.png");
-    exitBtn.tex = loadTex("buttons/EXIT button.png");
-    if (!exitBtn.tex) std::cerr << "Failed to load EXIT button texture\n";
-
-    GLuint bunnyTexIdle = loadTex("bunny sequence/bunny_sequence 1.png");
-    GLuint bunnyTexFlap = loadTex("bunny sequence/bunny_sequence 2.png");
-    GLuint bunnyTexDied = loadTex("bunny sequence/bunny died.png");
-
-    GLuint cloudTex1 = loadTex("clouds/cloud1.png");
-    GLuint cloudTex2 = loadTex("clouds/cloud2.png");
-
-    GLuint grassTex = loadTex("ground/grass.png");
-
-    GLuint numberTex[10];
+    Sprite bunnyTexIdle, bunnyTexFlap, bunnyTexDied, cloudTex1, cloudTex2, grassTex;
+    Sprite numberTex[10], bestScoreTex[10];
+    Sprite textGameTitle, textGameOver, textBestScore;
+
+    loadTex("buttons/START button.png", startBtn.tex);
+    loadTex("buttons/EXIT button.png", exitBtn.tex);
+    loadTex("bunny sequence/bunny_sequence 1.png", bunnyTexIdle);
+    loadTex("bunny sequence/bunny_sequence 2.png", bunnyTexFlap);
+    loadTex("clouds/cloud1.png", cloudTex1);
+    loadTex("clouds/cloud2.png", cloudTex2);
+    loadTex("ground/grass.png", grassTex);
+    loadTex("text/game title.png", textGameTitle);
+    loadTex("buttons/RESET button.png", resetBtn.tex);
+    loadTex("bunny sequence/bunny died.png", bunnyTexDied);
     for (int i = 0; i < 10; i++) {
         char path[64];
         snprintf(path, sizeof(path), "numbers/%d.png", i);
-        numberTex[i] = loadTex(path);
+        loadTex(path, numberTex[i]);
     }
-    GLuint textGameTitle = loadTex("text/game title.png");
-    GLuint textGameOver = loadTex("text/game over.png");
-    GLuint textBestScore = loadTex("text/best score.png");
-
-    GLuint bestScoreTex[10];
+    loadTex("text/game over.png", textGameOver);
+    loadTex("text/best score.png", textBestScore);
     for (int i = 0; i < 10; i++) {
         char path[64];
         snprintf(path, sizeof(path), "bestscores/%d.png", i);
-        bestScoreTex[i] = loadTex(path);
+        loadTex(path, bestScoreTex[i]);
     }
 
-    // Game state
-    float birdX = -0.4f, birdY = 0.0f;
-    const float birdRadius = 0.012f;
-    std::vector<Pipe> pipes;
-    const float pipeSpeed = 0.3f, spawnInterval = 1.6f;
-    const float cloudSpeed = pipeSpeed * WIN_W * 0.5f;
-    float timeSinceSpawn = 0.0f;
-    int score = 0;
+    // Pixel hitbox: the union of the two flying frames' alpha, filled in from the atlas pages
+    // as they are uploaded. The frame shown is wall-clock animation, not sim state, so the sim
+    // uses the union and stays deterministic.
+    CollisionMask bunnyMask;
+    bunnyMask.halfW = BUNNY_HALF_W;
+    bunnyMask.halfH = BUNNY_HALF_H;
+    auto isBunnyFrame = [&](const Sprite* s) { return s == &bunnyTexIdle || s == &bunnyTexFlap; };
+
+    GLint maxTexSize = 0; glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+
+    // a stale pack (image added or edited since the last bake) or one with pages this GPU
+    // can't take is ignored as a whole
+    if (usePack) {
+        for (const std::string& path : imagePaths) {
+            int e = pack.find(path.c_str(), PACK_SPRITE);
+            if (e < 0) { std::cerr << "assets.pak has no " << path << ", rebake it\n"; usePack = false; break; }
+            if (pack.sourceChanged(pack.entry(e), path.c_str())) { std::cerr << path << " changed since assets.pak was baked, rebake it\n"; usePack = false; break; }
+        }
+        for (int i = 0; usePack && i < pack.count(); i++) {
+            const PackEntry& e = pack.entry(i);
+            if (e.type == PACK_PAGE && (e.w > maxTexSize || e.h > maxTexSize)) { std::cerr << "assets.pak pages exceed GL_MAX_TEXTURE_SIZE\n"; usePack = false; }
+        }
+        if (!usePack) pack.close();
+    }
+    if (!usePack) {
+        for (const std::string& path : imagePaths) loader.add(path, assetImageGroup(path.c_str()));
+        loader.start(std::min(maxTexSize, 4096));
+    }
+
+    auto logGroup = [&](int group, size_t images, size_t pages, size_t bytes) {
+        std::cout << "Assets: group " << group << " ready after "
+            << std::chrono::duration<double, std::milli>(Clock::now() - processStart).count() << " ms, "
+            << images << " images, " << pages << " page(s), " << bytes / (1024 * 1024) << " MB"
+            << (usePack ? " (assets.pak)" : "") << "\n";
+        };
+
+    // pack side: pages go from the mapping straight to GL, sprites are matched by path
+    auto uploadPackGroup = [&](int group) {
+        std::vector<GLuint> pageTex(pack.count(), 0);
+        size_t images = 0, pages = 0, bytes = 0;
+        for (int i = 0; i < pack.count(); i++) {
+            const PackEntry& e = pack.entry(i);
+            if (e.type != PACK_PAGE || e.group != group) continue;
+            pageTex[i] = uploadTex(e.w, e.h, pack.data(e));
+            pages++; bytes += (size_t)e.size;
+        }
+        for (size_t t = 0; t < imagePaths.size(); t++) {
+            int idx = pack.find(imagePaths[t].c_str(), PACK_SPRITE);
+            const PackEntry& e = pack.entry(idx);
+            if (e.group != group) continue;
+            Sprite& s = *imageTargets[t];
+            s.tex = pageTex[e.page];
+            s.u0 = e.u0; s.v0 = e.v0; s.u1 = e.u1; s.v1 = e.v1;
+            s.fx0 = e.fx0; s.fy0 = e.fy0; s.fx1 = e.fx1; s.fy1 = e.fy1;
+            if (isBunnyFrame(&s)) {
+                const PackEntry& pg = pack.entry(e.page);
+                int x0 = (int)lroundf(e.u0 * pg.w), y0 = (int)lroundf(e.v0 * pg.h);
+                int x1 = (int)lroundf(e.u1 * pg.w), y1 = (int)lroundf(e.v1 * pg.h);
+                bunnyMask.addSprite(pack.data(pg), pg.w, x0, y0, x1 - x0, y1 - y0, e.fx0, e.fy0, e.fx1, e.fy1);
+            }
+            images++;
+        }
+        logGroup(group, images, pages, bytes);
+        };
+
+    // main thread side of the loader: upload finished groups and point their sprites at the pages
+    bool titleAssetsReady = false;
+    int packGroupsUploaded = 0;
+    auto uploadReadyAssets = [&]() {
+        if (usePack) {
+            // one group per call so the gameplay pages don't hold up the first frame
+            if (packGroupsUploaded < ASSET_GROUP_COUNT) uploadPackGroup(packGroupsUploaded++);
+            titleAssetsReady = true;
+            return;
+        }
+        AssetGroupResult r;
+        while (loader.takeReady(r)) {
+            std::vector<GLuint> pageTex;
+            for (const AtlasPage& pg : r.atlas.pages) pageTex.push_back(uploadTex(pg.w, pg.h, pg.rgba.data()));
+
+            for (size_t i = 0; i < r.atlas.sprites.size(); i++) {
+                const AtlasSprite& a = r.atlas.sprites[i];
+                if (a.page < 0) continue;
+                Sprite& s = *imageTargets[r.images[i]];
+                s.tex = pageTex[a.page];
+                s.u0 = a.u0; s.v0 = a.v0; s.u1 = a.u1; s.v1 = a.v1;
+                s.fx0 = a.fx0; s.fy0 = a.fy0; s.fx1 = a.fx1; s.fy1 = a.fy1;
+                if (isBunnyFrame(&s)) {
+                    const AtlasPage& pg = r.atlas.pages[a.page];
+                    bunnyMask.addSprite(pg.rgba.data(), pg.w, a.x, a.y, a.w, a.h, a.fx0, a.fy0, a.fx1, a.fy1);
+                }
+            }
+            if (r.group == ASSET_GROUP_TITLE) titleAssetsReady = true;
+            logGroup(r.group, r.images.size(), r.atlas.pages.size(), atlasBytes(r.atlas));
+        }
+        };
+    auto allAssetsUploaded = [&]() { return usePack ? packGroupsUploaded == ASSET_GROUP_COUNT : loader.allTaken(); };
+    while (!titleAssetsReady) {
+        uploadReadyAssets();
+        if (!titleAssetsReady) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!exitBtn.tex) std::cerr << "Failed to load EXIT button texture\n";
+    bunnyMask.finish();   // the bunny frames are in the title group
+    if (!bunnyMask.empty()) params.birdMask = &bunnyMask;
+    else std::cerr << "No bunny hitbox from the sprites, using the square one\n";
+    if (playPath) params = playback.gameParams();
+
+    // Sounds are decoded once (from the pack when there is one) and mixed on the audio thread,
+    // so a hop never touches the disk and no longer cuts off the lobby music.
+    AudioEngine audio;
+    auto loadSound = [&](const char* path)->int {
+        Sound snd;
+        int e = usePack ? pack.find(path, PACK_SOUND) : -1;
+        if (e >= 0 && pack.sourceChanged(pack.entry(e), path)) { std::cerr << path << " changed since assets.pak was baked, using the file\n"; e = -1; }
+        bool ok = e >= 0 ? parseWav(pack.data(pack.entry(e)), (size_t)pack.entry(e).size, snd) : loadWav(path, snd);
+        if (!ok) { std::cerr << "Failed load: " << path << "\n"; return -1; }
+        return audio.addSound(snd);
+        };
+    int hopSound = loadSound("sounds/hop.wav");
+    int deathSound = loadSound("sounds/death.wav");
+    Sound lobby;
+    int lobbySound = loadWav("lobby.wav", lobby) ? audio.addSound(lobby) : -1;   // optional, not shipped
+    audio.init(audioBackend, 44100, 128, 3, audioFile);
+    if (lobbySound >= 0) audio.play(lobbySound, 1.0f, true);
+
+    // Game state (rules live in GameSim, everything else here is presentation)
+    GameSim sim(params);
+    pipeInstances.reserve((size_t)maxLivePipes(params) * 2 * PIPE_INST_FLOATS);   // the sim reserved its pipes too
+    const float cloudSpeed = sim.params.pipeSpeed * WIN_W * 0.5f;
+    float simAccum = 0.0f;
+    bool pendingFlap = false;
+    int64_t pendingFlapNs = 0;   // when the pending flap's input arrived, 0 = not from the player
+    size_t playCursor = 0;
+    bool playbackDone = false;
     int bestScore = 0;
-    bool gameStarted = false, gameOver = false;
+    bool gameStarted = false;
     float bunnyAnimTimer = 0.0f; const float bunnyAnimDuration = 0.2f;
     int bunnyFrame = 0;
-    bool firstFlapDone = false;
 
-    double mouseX = 0, mouseY = 0; bool mouseJustPressed = false, clickFlag = false;
-    glfwSetWindowUserPointer(win, &clickFlag);
+    // Input callbacks stamp their events so --latency measures from the moment GLFW saw them.
+    struct InputEvents { bool click = false; int64_t clickNs = 0, spaceNs = 0; } inputEvents;
+    double mouseX = 0, mouseY = 0; bool mouseJustPressed = false;
+    glfwSetWindowUserPointer(win, &inputEvents);
     glfwSetMouseButtonCallback(win, [](GLFWwindow* w, int button, int action, int mods) {
         if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-            bool* p = (bool*)glfwGetWindowUserPointer(w);
-            if (p) *p = true;
+            InputEvents* p = (InputEvents*)glfwGetWindowUserPointer(w);
+            if (p) { p->click = true; p->clickNs = profNowNs(); }
+        }
+        });
+    glfwSetKeyCallback(win, [](GLFWwindow* w, int key, int scancode, int action, int mods) {
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+            InputEvents* p = (InputEvents*)glfwGetWindowUserPointer(w);
+            if (p) p->spaceNs = profNowNs();
         }
         });
 
     glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    auto pixelToNDC = [&](float px, float py, int fbw, int fbh) {
-        return std::pair<float, float>((px / fbw) * 2.0f - 1.0f, 1.0f - (py / fbh) * 2.0f);
-        };
-
-    auto drawTexPixel = [&](GLuint tex, float cx, float cy, float w, float h, int fbw, int fbh, float alpha = 1.0f) {
-        if (!tex) return;
-        glBindTexture(GL_TEXTURE_2D, tex);
-        auto ndc = pixelToNDC(cx, cy, fbw, fbh);
-        float sx = (w / (float)fbw) * 2.0f, sy = (h / (float)fbh) * 2.0f;
-        glUseProgram(texProg);
-        glBindVertexArray(vaoTex);
-        glActiveTexture(GL_TEXTURE0);
-        glUniform1i(texLocTex, 0);
-        glUniform2f(texLocPos, ndc.first, ndc.second);
-        glUniform2f(texLocScale, sx, sy);
-        glUniform1f(texLocAlpha, alpha);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // queued into the sprite batch; actual GL draws happen on texture change / flush
+    auto drawTexPixel = [&](const Sprite& tex, float cx, float cy, float w, float h, int fbw, int fbh, float alpha = 1.0f) {
+        sprites.draw(tex, cx, cy, w, h, fbw, fbh, alpha);
         };
 
     auto drawButton = [&](const UIButton& b, int fbw, int fbh) {
@@ -264,7 +490,7 @@ int main() {
         {0.85f, 0.18f, 0.45f, 0.35f}
     };
 
-    GLuint cloudTexs[] = { cloudTex1, cloudTex2, cloudTex1, cloudTex2 };
+    Sprite cloudTexs[] = { cloudTex1, cloudTex2, cloudTex1, cloudTex2 };
 
     clouds.clear();
     for (int i = 0; i < 4; i++) {
@@ -277,17 +503,21 @@ int main() {
         }
     }
 
-    // Button callbacks
+    // Button callbacks. The seed is printed so a course can be replayed or shared with --seed.
     startBtn.onClick = [&]() {
-        birdY = 0.0f; pipes.clear(); timeSinceSpawn = 0; score = 0;
-        gameStarted = true; gameOver = false; firstFlapDone = false;
+        uint32_t seed = haveSeed ? courseSeed : (uint32_t)time(nullptr);
+        std::cout << "Course seed " << seed << "\n";
+        sim.reset(seed); simAccum = 0.0f; pendingFlap = false; pendingFlapNs = 0;
+        if (recordPath) recorder.begin(recordPath, sim.params, seed);
+        playCursor = 0; playbackDone = false;
+        gameStarted = true;
         startBtn.visible = false; resetBtn.visible = false;
         exitBtn.visible = false;
-        char buf[128]; snprintf(buf, sizeof(buf), "Bunny Hop Adventure - Score: %d", score); glfwSetWindowTitle(win, buf);
+        char buf[128]; snprintf(buf, sizeof(buf), "Bunny Hop Adventure - Score: %d", sim.score); glfwSetWindowTitle(win, buf);
         };
     resetBtn.onClick = [&]() {
-        birdY = 0.0f; pipes.clear(); timeSinceSpawn = 0; score = 0;
-        gameStarted = false; gameOver = false; firstFlapDone = false;
+        sim.reset(courseSeed); simAccum = 0.0f; pendingFlap = false; pendingFlapNs = 0;   // back to the title; start reseeds
+        gameStarted = false;
         startBtn.visible = true; exitBtn.visible = true; resetBtn.visible = false;
         char buf[128];
         snprintf(buf, sizeof(buf), "Bunny Hop Adventure - Best: %d", bestScore);
@@ -298,36 +528,23 @@ int main() {
     auto now = Clock::now(); auto last = now;
     auto startTime = Clock::now();
 
-    const float pipeWidth = 0.12f;
-    const float pipeGapSize = 0.50f;
-    const float flapStrength = 0.60f;
-    const float gravity = -2.30f;
-    float birdVel = 0.0f;
-
-    srand((unsigned int)time(nullptr));
-
     // drawScore - UPDATED TO BE RESPONSIVE
-    std::function<void(int, int, int, bool)> drawScore;
-    drawScore = [&](int scoreVal, int fbw, int fbh, bool isGameOver)
+    // digits go through fixed arrays: nothing in the frame loop touches the heap
+    auto drawScore = [&](int scoreVal, int fbw, int fbh, bool isGameOver)
         {
             float elapsed = std::chrono::duration<float>(Clock::now() - startTime).count();
 
             // current score (gameplay only)
             if (!isGameOver && gameStarted) {
-                std::vector<int> digits;
-                if (scoreVal == 0) digits.push_back(0);
-                else {
-                    int tmp = scoreVal;
-                    while (tmp > 0) { digits.push_back(tmp % 10); tmp /= 10; }
-                    std::reverse(digits.begin(), digits.end());
-                }
+                int digits[10];
+                int numDigits = toDigits(scoreVal, digits);
 
                 float numW = 80.0f, numH = 70.0f;
-                float totalW = numW * digits.size();
+                float totalW = numW * numDigits;
                 float x = (fbw - totalW) * 0.5f + numW * 0.5f;
                 float y = fbh * 0.03f + numH * 0.5f;
 
-                for (int i = 0; i < (int)digits.size(); i++)
+                for (int i = 0; i < numDigits; i++)
                     drawTexPixel(numberTex[digits[i]], x + i * numW, y, numW, numH, fbw, fbh);
             }
 
@@ -355,13 +572,8 @@ int main() {
             // best score (game over only) -- FIXED SIZE
             if (isGameOver)
             {
-                std::vector<int> bestDigits;
-                if (bestScore == 0) bestDigits.push_back(0);
-                else {
-                    int tmp = bestScore;
-                    while (tmp > 0) { bestDigits.push_back(tmp % 10); tmp /= 10; }
-                    std::reverse(bestDigits.begin(), bestDigits.end());
-                }
+                int bestDigits[10];
+                int numBestDigits = toDigits(bestScore, bestDigits);
 
                 // Calculate scale based on current window height
                 // 720.0f is our reference height. If window is 1440p, text doubles in size.
@@ -377,22 +589,98 @@ int main() {
 
                 float spacing = 20.0f * uiScale;
 
-                float numbersWidth = digitW * bestDigits.size();
+                float numbersWidth = digitW * numBestDigits;
                 float totalWidth = labelW + spacing + numbersWidth;
                 float centerY = fbh * 0.40f; // Positioned between Game Over and Reset
                 float labelX = (fbw - totalWidth) * 0.5f + labelW * 0.5f;
                 float numbersStartX = labelX + labelW * 0.5f + spacing + digitW * 0.5f;
 
                 drawTexPixel(textBestScore, labelX, centerY, labelW, labelH, fbw, fbh, 0.95f);
-                for (int i = 0; i < (int)bestDigits.size(); i++) {
+                for (int i = 0; i < numBestDigits; i++) {
                     float dx = numbersStartX + i * digitW;
                     drawTexPixel(bestScoreTex[bestDigits[i]], dx, centerY, digitW, digitH, fbw, fbh, 1.0f);
                 }
             }
         };
 
+    // Profiler overlay (F3): the last 120 frames as bars, CPU work coloured against the 60 Hz
+    // budget and time spent in swap (vsync / driver wait) in grey on top, GPU time as a blue
+    // mark, with lines for the budget and the p50 (green) / p99 (orange) frame times. Above
+    // the graph: frame p50, frame p99 and GPU p50 in ms.
+    std::vector<float> overlayRects;
+    overlayRects.reserve(512 * PIPE_INST_FLOATS);
+    auto drawProfileOverlay = [&](int fbw, int fbh) {
+        const int bars = 120;
+        const float barW = 2.0f, graphH = 100.0f, graphMs = 33.3f, budgetMs = 1000.0f / 60.0f;
+        const float px = 10.0f, py = 10.0f, panelW = bars * barW + 20.0f, panelH = graphH + 45.0f;
+        auto rect = [&](float x, float y, float w, float h, float r, float g, float b) {   // pixels, top-left corner
+            const float inst[PIPE_INST_FLOATS] = {
+                (x + w * 0.5f) / fbw * 2.0f - 1.0f, 1.0f - (y + h * 0.5f) / fbh * 2.0f, w / fbw * 2.0f, h / fbh * 2.0f, r, g, b };
+            overlayRects.insert(overlayRects.end(), inst, inst + PIPE_INST_FLOATS);
+            };
+        auto msToH = [&](float ms) { return std::min(std::max(ms, 0.0f), graphMs) / graphMs * graphH; };
+
+        float p50 = gProfiler.percentileMs(PROF_FRAME, 0.5f), p99 = gProfiler.percentileMs(PROF_FRAME, 0.99f);
+        float gx = px + 10.0f, base = py + panelH - 10.0f;
+        overlayRects.clear();
+        rect(px, py, panelW, panelH, 0.1f, 0.1f, 0.12f);
+        int n = std::min(bars, gProfiler.frames());
+        for (int i = 0; i < n; i++) {
+            const FrameSample& f = gProfiler.frame(i);
+            float work = f.phaseMs[PROF_FRAME] - f.phaseMs[PROF_SWAP] - f.phaseMs[PROF_PACE];
+            float hw = msToH(work), ht = msToH(f.phaseMs[PROF_FRAME]);
+            float x = gx + (bars - 1 - i) * barW;
+            if (work < budgetMs * 0.5f) rect(x, base - hw, barW, hw, 0.3f, 0.85f, 0.3f);
+            else if (work < budgetMs) rect(x, base - hw, barW, hw, 0.95f, 0.85f, 0.2f);
+            else rect(x, base - hw, barW, hw, 0.95f, 0.25f, 0.2f);
+            rect(x, base - ht, barW, ht - hw, 0.45f, 0.45f, 0.5f);
+            if (f.gpuMs[PROF_FRAME] > 0.0f) rect(x, base - msToH(f.gpuMs[PROF_FRAME]) - 1.0f, barW, 2.0f, 0.3f, 0.6f, 1.0f);
+        }
+        rect(gx, base - msToH(budgetMs), bars * barW, 1.0f, 1.0f, 1.0f, 1.0f);
+        rect(gx, base - msToH(p50), bars * barW, 1.0f, 0.3f, 0.85f, 0.3f);
+        rect(gx, base - msToH(p99), bars * barW, 1.0f, 1.0f, 0.55f, 0.1f);
+
+        // "12.3" with the score digits; the decimal point is a rect
+        const float dw = 12.0f, dh = 16.0f, ty = py + 8.0f;
+        auto drawMs = [&](float ms, float x, float r, float g, float b) {
+            rect(x, ty + 4.0f, 8.0f, 8.0f, r, g, b);
+            x += 14.0f;
+            char buf[16]; snprintf(buf, sizeof(buf), "%.1f", std::min(ms, 999.9f));
+            for (const char* c = buf; *c; c++) {
+                if (*c == '.') { rect(x + 1.0f, ty + dh - 3.0f, 3.0f, 3.0f, 1.0f, 1.0f, 1.0f); x += 5.0f; continue; }
+                drawTexPixel(numberTex[*c - '0'], x + dw * 0.5f, ty + dh * 0.5f, dw, dh, fbw, fbh);
+                x += dw;
+            }
+            };
+        drawMs(p50, gx, 0.3f, 0.85f, 0.3f);
+        drawMs(p99, gx + 80.0f, 1.0f, 0.55f, 0.1f);
+        if (gpuTimer.active()) drawMs(gProfiler.percentileMs(PROF_FRAME, 0.5f, true), gx + 160.0f, 0.3f, 0.6f, 1.0f);
+        drawRects(overlayRects);
+        sprites.flush();
+        };
+    gProfiler.setEnabled(showProfile || tracePath);
+
+    // GPU passes (only while profiling): sprites queued in a pass are flushed before its query
+    // ends so the draws land in the pass that queued them.
+    auto gpuBegin = [&](int phase) { if (gpuTimer.active()) gpuTimer.pass(phase); };
+    auto gpuEnd = [&]() { if (gpuTimer.active()) { sprites.flush(); gpuTimer.pass(-1); } };
+
+    // --alloc-check N: play on autopilot (restarting after every death) as fast as the driver
+    // allows, then count main thread heap allocations over N frames once the assets are all in
+    // and a short warm-up has passed. Any allocation fails the run (exit code 1).
+    const int ALLOC_WARMUP = 120;
+    int allocFrame = 0, allocFirstBad = -1;
+    AllocStats allocBase, allocPrev;
+
     // Main loop
+    bool firstFrame = true, pacingSettled = false;
     while (!glfwWindowShouldClose(win)) {
+        gProfiler.beginFrame();
+        gpuTimer.beginFrame();
+        {
+            PROFILE_SCOPE(PROF_PACE);
+            pacer.waitForFrame();   // before input is read, so the frame starts from the latest
+        }
         now = Clock::now();
         float dt = std::chrono::duration<float>(now - last).count();
         if (dt > 0.05f) dt = 0.05f;
@@ -417,129 +705,119 @@ int main() {
         resetBtn.y = fbh * 0.5f;
         // -----------------------------
 
-        glfwPollEvents();
-
-        if (clickFlag) { glfwGetCursorPos(win, &mouseX, &mouseY); mouseJustPressed = true; clickFlag = false; }
-
-        static bool spacePrev = false;
-        bool spaceNow = (glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS);
+        {
+            PROFILE_SCOPE(PROF_POLL);
+            glfwPollEvents();
+        }
+        if (!allAssetsUploaded()) {
+            PROFILE_SCOPE(PROF_ASSETS);
+            uploadReadyAssets();
+        }
 
-        // Mouse click hop or button clicks
-        if (mouseJustPressed) {
-            if (startBtn.visible &&
-                (mouseX >= startBtn.x - startBtn.w / 2 && mouseX <= startBtn.x + startBtn.w / 2 &&
-                    mouseY >= startBtn.y - startBtn.h / 2 && mouseY <= startBtn.y + startBtn.h / 2)) {
-                startBtn.onClick();
-            }
-            else if (resetBtn.visible &&
-                (mouseX >= resetBtn.x - resetBtn.w / 2 && mouseX <= resetBtn.x + resetBtn.w / 2 &&
-                    mouseY >= resetBtn.y - resetBtn.h / 2 && mouseY <= resetBtn.y + resetBtn.h / 2)) {
-                resetBtn.onClick();
-            }
-            else if (exitBtn.visible &&
-                (mouseX >= exitBtn.x - exitBtn.w / 2 && mouseX <= exitBtn.x + exitBtn.w / 2 &&
-                    mouseY >= exitBtn.y - exitBtn.h / 2 && mouseY <= exitBtn.y + exitBtn.h / 2)) {
-                exitBtn.onClick();
+        {
+            PROFILE_SCOPE(PROF_INPUT);
+            if (inputEvents.click) { glfwGetCursorPos(win, &mouseX, &mouseY); mouseJustPressed = true; inputEvents.click = false; }
+
+            static bool spacePrev = false, f3Prev = false;
+            bool spaceNow = (glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS);
+            bool f3Now = (glfwGetKey(win, GLFW_KEY_F3) == GLFW_PRESS);
+            if (f3Now && !f3Prev) {
+                showProfile = !showProfile;
+                gProfiler.setEnabled(showProfile || tracePath);
             }
-            else if (gameStarted && !gameOver) {
-                birdVel = +flapStrength;
-                firstFlapDone = true;
-                PlaySound(TEXT("hop.wav"), nullptr, SND_FILENAME | SND_ASYNC);
+            f3Prev = f3Now;
+
+            // Mouse click hop or button clicks
+            if (mouseJustPressed) {
+                if (startBtn.visible &&
+                    (mouseX >= startBtn.x - startBtn.w / 2 && mouseX <= startBtn.x + startBtn.w / 2 &&
+                        mouseY >= startBtn.y - startBtn.h / 2 && mouseY <= startBtn.y + startBtn.h / 2)) {
+                    startBtn.onClick();
+                }
+                else if (resetBtn.visible &&
+                    (mouseX >= resetBtn.x - resetBtn.w / 2 && mouseX <= resetBtn.x + resetBtn.w / 2 &&
+                        mouseY >= resetBtn.y - resetBtn.h / 2 && mouseY <= resetBtn.y + resetBtn.h / 2)) {
+                    resetBtn.onClick();
+                }
+                else if (exitBtn.visible &&
+                    (mouseX >= exitBtn.x - exitBtn.w / 2 && mouseX <= exitBtn.x + exitBtn.w / 2 &&
+                        mouseY >= exitBtn.y - exitBtn.h / 2 && mouseY <= exitBtn.y + exitBtn.h / 2)) {
+                    exitBtn.onClick();
+                }
+                else if (gameStarted && !sim.dead && !playPath) {
+                    pendingFlap = true;
+                    if (!pendingFlapNs) pendingFlapNs = inputEvents.clickNs ? inputEvents.clickNs : profNowNs();
+                }
+                mouseJustPressed = false;
             }
-            mouseJustPressed = false;
-        }
 
-        if (gameStarted && !gameOver && spaceNow && !spacePrev) {
-            birdVel = +flapStrength;
-            firstFlapDone = true;
-            PlaySound(TEXT("hop.wav"), nullptr, SND_FILENAME | SND_ASYNC);
-        }
-        spacePrev = spaceNow;
+            if (gameStarted && !sim.dead && !playPath && spaceNow && !spacePrev) {
+                pendingFlap = true;
+                if (!pendingFlapNs) pendingFlapNs = inputEvents.spaceNs ? inputEvents.spaceNs : profNowNs();
+            }
+            spacePrev = spaceNow;
+            if (playPath && !gameStarted) startBtn.onClick();
 
-        if (gameStarted && firstFlapDone) {
-            birdVel += gravity * dt;
-            birdY += birdVel * dt;
+            if (allocCheck > 0) {
+                if (!gameStarted || sim.dead) startBtn.onClick();
+                else if (scriptedFlap(sim)) pendingFlap = true;
+            }
         }
 
-        if (birdY + birdRadius > 1.0f) {
-            birdY = 1.0f - birdRadius;
-            birdVel = 0;
-        }
+        // Fixed-step simulation: the frame dt only decides how many ticks to run.
+        if (gameStarted) {
+            PROFILE_SCOPE(PROF_SIM);
+            simAccum += dt;
+            while (simAccum >= sim.params.fixedDt) {
+                InputFrame in; in.flap = pendingFlap; pendingFlap = false;
+                int64_t flapNs = pendingFlapNs; pendingFlapNs = 0;
+                if (playPath) {
+                    if (playbackDone) { simAccum = 0.0f; break; }   // the recording ends here
+                    in = playback.input(sim, playCursor);
+                }
+                recorder.record(sim, in);
+                uint32_t ev = sim.step(in);
+                simAccum -= sim.params.fixedDt;
+
+                if (playPath && !playbackDone && (sim.dead || sim.tick >= playback.endTick)) {
+                    playbackDone = true;
+                    bool match = sim.tick == playback.endTick && sim.score == playback.score && sim.dead == playback.died &&
+                        replayStateHash(sim) == playback.stateHash;
+                    printf("Playback: score %d (recorded %d), %s at tick %u (recorded %s at %u) -> %s\n", sim.score, playback.score,
+                        sim.dead ? "died" : "ended", sim.tick, playback.died ? "died" : "ended", playback.endTick, match ? "match" : "MISMATCH");
+                    resetBtn.visible = true;
+                    exitBtn.visible = true;
+                }
 
-        if (birdY - birdRadius < -1.0f) {
-            birdY = -1.0f + birdRadius;
-            gameOver = true;
-            resetBtn.visible = true;
-            exitBtn.visible = true;
+                if (ev & SIM_EV_FLAP) { audio.play(hopSound); latency.flapApplied(flapNs); }
+                if (ev & SIM_EV_SCORED) {
+                    if (sim.score > bestScore) bestScore = sim.score;
+                    char buf[128]; snprintf(buf, sizeof(buf), "Bunny Hop Adventure - Score: %d  Best: %d", sim.score, bestScore);
+                    glfwSetWindowTitle(win, buf);
+                }
+                if (ev & SIM_EV_DIED) {
+                    recorder.finish(sim);
+                    audio.play(deathSound);
+                    resetBtn.visible = true;
+                    exitBtn.visible = true;
+                }
+            }
         }
-
-        if (!gameStarted) {
-            birdY = 0.0f;
-            birdVel = 0.0f;
+        else {
             exitBtn.visible = true;
             startBtn.visible = true;
             resetBtn.visible = false;
         }
+        const bool gameOver = sim.dead;
+        const float simAlpha = simAccum / sim.params.fixedDt;
 
-        if (gameStarted && !gameOver) {
-            timeSinceSpawn += dt;
-            if (timeSinceSpawn > spawnInterval) {
-                timeSinceSpawn = 0.0f;
-                Pipe p;
-                p.x = 1.2f;
-                p.width = pipeWidth;
-                p.gapSize = pipeGapSize;
-                float margin = 0.2f;
-                float halfGap = p.gapSize * 0.5f;
-                p.gapY = -1.0f + margin + halfGap + ((float)rand() / RAND_MAX) * (2.0f - 2.0f * margin - p.gapSize);
-                p.scored = false;
-                pipes.push_back(p);
-            }
-        }
-
-        if (gameStarted && !gameOver) {
-            for (auto& p : pipes) p.x -= pipeSpeed * dt;
-        }
-
-        for (auto& p : pipes) {
-            if (!p.scored && p.x + p.width * 0.5f < birdX) {
-                p.scored = true;
-                score++;
-                if (score > bestScore) bestScore = score;
-                char buf[128]; snprintf(buf, sizeof(buf), "Bunny Hop Adventure - Score: %d  Best: %d", score, bestScore);
-                glfwSetWindowTitle(win, buf);
-            }
-        }
-
-        while (!pipes.empty() && pipes.front().x + pipes.front().width < -1.5f) pipes.erase(pipes.begin());
-
-        float aspect = (float)fbw / (float)fbh;
-        for (auto& p : pipes) {
-            float pl = p.x - p.width * 0.5f;
-            float pr = p.x + p.width * 0.5f;
-            float gt = p.gapY + p.gapSize * 0.5f;
-            float gb = p.gapY - p.gapSize * 0.5f;
-
-            float scaledBirdLeft = (birdX - birdRadius) * aspect;
-            float scaledBirdRight = (birdX + birdRadius) * aspect;
-            float scaledPipeLeft = pl * aspect;
-            float scaledPipeRight = pr * aspect;
-
-            bool overlapsX = !(scaledBirdRight < scaledPipeLeft || scaledBirdLeft > scaledPipeRight);
-            bool insideGap = (birdY + birdRadius < gt) && (birdY - birdRadius > gb);
-
-            if (overlapsX && !insideGap) {
-                gameOver = true;
-                resetBtn.visible = true;
-                exitBtn.visible = true;
-                break;
-            }
-        }
-
-        for (auto& c : clouds) {
-            if (!gameOver) {
-                c.x_px -= c.speed * dt;
-                if (c.x_px + c.w_px < 0) c.x_px = WIN_W + 10.0f;
+        {
+            PROFILE_SCOPE(PROF_CLOUDS);
+            for (auto& c : clouds) {
+                if (!gameOver) {
+                    c.x_px -= c.speed * dt;
+                    if (c.x_px + c.w_px < 0) c.x_px = WIN_W + 10.0f;
+                }
             }
         }
 
@@ -551,11 +829,22 @@ int main() {
             }
         }
 
-        glViewport(0, 0, fbw, fbh);
-        glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        {
+            PROFILE_SCOPE(PROF_CLEAR);
+            gpuBegin(PROF_CLEAR);
+            glViewport(0, 0, fbw, fbh);
+            glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            sprites.resetStats();
+            gpuEnd();
+        }
 
+        // Sprites are only queued until a flush, so the flush after the clouds is where grass
+        // and clouds are actually submitted, and the one after the buttons submits the rest
+        // (gpuEnd() flushes every pass, but only while GPU timing is on).
         if (grassTex) {
+            PROFILE_SCOPE(PROF_GRASS);
+            gpuBegin(PROF_GRASS);
             const float grassOrigAspect = 940.0f / 788.0f;
             float grassHeight = fbh * 0.12f;
             float grassWidth = grassHeight * grassOrigAspect;
@@ -565,50 +854,136 @@ int main() {
                 float grassX = i * grassWidth + grassWidth * 0.5f;
                 drawTexPixel(grassTex, grassX, grassY, grassWidth, grassHeight, fbw, fbh, 1.0f);
             }
+            gpuEnd();
         }
 
-        for (auto& c : clouds) drawTexPixel(c.tex, c.x_px + c.w_px * 0.5f, c.y_px + c.h_px * 0.5f, c.w_px, c.h_px, fbw, fbh, 0.95f);
+        {
+            PROFILE_SCOPE(PROF_CLOUDS);
+            gpuBegin(PROF_CLOUDS);
+            for (auto& c : clouds) drawTexPixel(c.tex, c.x_px + c.w_px * 0.5f, c.y_px + c.h_px * 0.5f, c.w_px, c.h_px, fbw, fbh, 0.95f);
+            sprites.flush();
+            gpuEnd();
+        }
 
-        glUseProgram(prog);
-        glBindVertexArray(vao);
-        const float pipeR = 0.45f, pipeG = 0.8f, pipeB = 0.45f;
-
-        for (auto& p : pipes) {
-            float pl = p.x - p.width * 0.5f;
-            float pr = p.x + p.width * 0.5f;
-            float gt = p.gapY + p.gapSize * 0.5f;
-            float gb = p.gapY - p.gapSize * 0.5f;
-
-            float topHeight = 1.0f - gt;
-            float topCenterY = gt + topHeight * 0.5f;
-            glUniform3f(locColor, pipeR, pipeG, pipeB);
-            glUniform2f(locPos, (pl + pr) * 0.5f, topCenterY);
-            glUniform2f(locScale, p.width, topHeight);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            float bottomHeight = gb + 1.0f;
-            float bottomCenterY = -1.0f + bottomHeight * 0.5f;
-            glUniform3f(locColor, pipeR * 0.92f, pipeG * 0.92f, pipeB * 0.92f);
-            glUniform2f(locPos, (pl + pr) * 0.5f, bottomCenterY);
-            glUniform2f(locScale, p.width, bottomHeight);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+        {
+            PROFILE_SCOPE(PROF_PIPES);
+            gpuBegin(PROF_PIPES);
+            const float pipeR = 0.45f, pipeG = 0.8f, pipeB = 0.45f;
+
+            pipeInstances.clear();
+            for (auto& p : sim.pipes) {
+                float px = sim.renderPipeX(p, simAlpha);
+                float pl = px - p.width * 0.5f;
+                float pr = px + p.width * 0.5f;
+                float gt = p.gapY + p.gapSize * 0.5f;
+                float gb = p.gapY - p.gapSize * 0.5f;
+
+                float topHeight = 1.0f - gt;
+                float topCenterY = gt + topHeight * 0.5f;
+                float bottomHeight = gb + 1.0f;
+                float bottomCenterY = -1.0f + bottomHeight * 0.5f;
+                const float inst[2 * PIPE_INST_FLOATS] = {
+                    (pl + pr) * 0.5f, topCenterY, p.width, topHeight, pipeR, pipeG, pipeB,
+                    (pl + pr) * 0.5f, bottomCenterY, p.width, bottomHeight, pipeR * 0.92f, pipeG * 0.92f, pipeB * 0.92f,
+                };
+                pipeInstances.insert(pipeInstances.end(), inst, inst + 2 * PIPE_INST_FLOATS);
+            }
+
+            drawRects(pipeInstances);
+            gpuEnd();
+        }
+
+        {
+            PROFILE_SCOPE(PROF_BUNNY);
+            gpuBegin(PROF_BUNNY);
+            const Sprite& currentBunnyTex = gameOver ? bunnyTexDied : (bunnyFrame == 0 ? bunnyTexIdle : bunnyTexFlap);
+            float bunny_px_x = ((sim.params.birdX + 1.0f) * 0.5f) * fbw;
+            float bunny_px_y = ((1.0f - sim.renderBirdY(simAlpha)) * 0.5f) * fbh;
+            // the frame the hitbox covers: 90x90 px at 1280x720, scaled with the framebuffer
+            drawTexPixel(currentBunnyTex, bunny_px_x, bunny_px_y, BUNNY_HALF_W * fbw, BUNNY_HALF_H * fbh, fbw, fbh);
+            gpuEnd();
+        }
+
+        {
+            PROFILE_SCOPE(PROF_SCORE);
+            gpuBegin(PROF_SCORE);
+            drawScore(sim.score, fbw, fbh, gameOver);
+            gpuEnd();
+        }
+        {
+            PROFILE_SCOPE(PROF_BUTTONS);
+            gpuBegin(PROF_BUTTONS);
+            drawButton(startBtn, fbw, fbh);
+            drawButton(exitBtn, fbw, fbh);
+            drawButton(resetBtn, fbw, fbh);
+            sprites.flush();
+            gpuEnd();
+        }
+        if (showProfile) {
+            PROFILE_SCOPE(PROF_OVERLAY);
+            gpuBegin(PROF_OVERLAY);
+            drawProfileOverlay(fbw, fbh);
+            gpuEnd();
         }
 
-        glUseProgram(texProg);
-        glBindVertexArray(vaoTex);
-        GLuint currentBunnyTex = gameOver ? bunnyTexDied : (bunnyFrame == 0 ? bunnyTexIdle : bunnyTexFlap);
-        float bunny_px_x = ((birdX + 1.0f) * 0.5f) * fbw;
-        float bunny_px_y = ((1.0f - birdY) * 0.5f) * fbh;
-        drawTexPixel(currentBunnyTex, bunny_px_x, bunny_px_y, 90, 90, fbw, fbh);
+        {
+            PROFILE_SCOPE(PROF_SWAP);
+            glfwSwapBuffers(win);
+        }
+        pacer.framePresented();
+        latency.framePresented();   // polls earlier frames' fences; with --gpu-drain, glFinish first
+        if (!pacingSettled && allAssetsUploaded()) { pacer.resetStats(); pacingSettled = true; }   // loading hitches aren't pacing
+        if (firstFrame) {
+            firstFrame = false;
+            std::cout << "Time to first frame: " << std::chrono::duration<double, std::milli>(Clock::now() - processStart).count() << " ms\n";
+        }
+
+        if (allocCheck > 0 && allAssetsUploaded()) {
+            AllocStats a = allocStatsThread();
+            if (allocFrame == ALLOC_WARMUP) allocBase = a;
+            else if (allocFrame > ALLOC_WARMUP && a.count != allocPrev.count && allocFirstBad < 0) allocFirstBad = allocFrame - ALLOC_WARMUP;
+            allocPrev = a;
+            if (++allocFrame > ALLOC_WARMUP + allocCheck) glfwSetWindowShouldClose(win, 1);
+        }
+    }
 
-        drawScore(score, fbw, fbh, gameOver);
-        drawButton(startBtn, fbw, fbh);
-        drawButton(exitBtn, fbw, fbh);
-        drawButton(resetBtn, fbw, fbh);
+    recorder.finish(sim);   // closed mid-run: the replay ends where the player left
+    ReplayWriter::Report recorded = recorder.flush();
+    if (recorded.failed) std::cerr << "Cannot write replay " << recorded.failed << "\n";
+    if (recorded.lastSaved) std::cout << "Replay saved to " << recorded.lastSaved << "\n";
+    if (recorded.droppedChunks) std::cerr << "Replay writer fell behind: " << recorded.droppedChunks << " chunk(s) dropped, those runs were not saved\n";
+
+    int exitCode = 0;
+    if (allocCheck > 0) {
+        int frames = std::max(0, allocFrame - ALLOC_WARMUP - 1);
+        uint64_t n = frames ? allocPrev.count - allocBase.count : 0, bytes = frames ? allocPrev.bytes - allocBase.bytes : 0;
+        bool pass = frames == allocCheck && n == 0;   // closing the window early fails too
+        printf("Alloc check: %d frames, %llu allocations (%llu bytes) on the main thread", frames,
+            (unsigned long long)n, (unsigned long long)bytes);
+        if (allocFirstBad >= 0) printf(", first in frame %d", allocFirstBad);
+        printf(" -> %s\n", pass ? "PASS" : "FAIL");
+        exitCode = pass ? 0 : 1;
+    }
 
-        glfwSwapBuffers(win);
+    if (gProfiler.enabled) gProfiler.printSummary();
+    pacer.printReport(gProfiler.enabled);   // the histogram itself with --profile / F3
+    if (latency.measuring) {
+        char label[64];
+        if (pacer.mode() == PresentMode::Capped) snprintf(label, sizeof(label), "capped %.0f Hz", fpsCap);
+        else snprintf(label, sizeof(label), "%s", presentModeName(pacer.mode()));
+        if (latency.drainGpu) strncat(label, " + GPU drain", sizeof(label) - strlen(label) - 1);
+        latency.printReport(label, gProfiler.enabled);
+        latency.writeCsv(latencyPath, label);
     }
+    if (tracePath) gProfiler.writeChromeTrace(tracePath);
+
+    AudioStats as = audio.stats();
+    audio.shutdown();
+    std::cout << "Audio: " << as.blocks << " blocks, peak " << as.voicesPeak << " voices, trigger pickup avg "
+        << as.pickupAvgMs << " ms / max " << as.pickupMaxMs << " ms + " << as.outputLatencyMs << " ms buffered, mix "
+        << as.mixAvgUs << " us/block\n";
 
+    gpuTimer.destroy();
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
@@ -0,0 +1,155 @@
+// frame_pacer.cpp
+// Hop Hop Bunny - present modes and frame pacing
+
+#include "frame_pacer.h"
+#include "profiler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+const char* presentModeName(PresentMode m) {
+    switch (m) {
+    case PresentMode::Vsync: return "vsync";
+    case PresentMode::Uncapped: return "uncapped";
+    case PresentMode::Capped: return "capped";
+    case PresentMode::Adaptive: return "adaptive";
+    }
+    return "?";
+}
+
+bool parsePresentMode(const char* s, PresentMode& m) {
+    const PresentMode all[] = { PresentMode::Vsync, PresentMode::Uncapped, PresentMode::Capped, PresentMode::Adaptive };
+    for (PresentMode p : all) {
+        if (std::strcmp(s, presentModeName(p)) == 0) { m = p; return true; }
+    }
+    return false;
+}
+
+void PacingHistogram::add(double ms) {
+    int b = (int)(ms / BIN_MS);
+    bins[b < 0 ? 0 : b >= BINS ? BINS - 1 : b]++;
+    if (!count || ms < minMs) minMs = ms;
+    if (!count || ms > maxMs) maxMs = ms;
+    count++;
+    sumMs += ms;
+    sumSqMs += ms * ms;
+}
+
+double PacingHistogram::stddevMs() const {
+    if (count < 2) return 0.0;
+    double mean = meanMs();
+    double var = sumSqMs / count - mean * mean;
+    return var > 0.0 ? std::sqrt(var) : 0.0;
+}
+
+double PacingHistogram::percentileMs(double q) const {
+    if (!count) return 0.0;
+    uint64_t want = (uint64_t)(q * (count - 1)) + 1, seen = 0;
+    for (int b = 0; b < BINS; b++) {
+        seen += bins[b];
+        if (seen >= want) return b == BINS - 1 ? maxMs : (b + 1) * BIN_MS;
+    }
+    return maxMs;
+}
+
+void PacingHistogram::print(const char* title, double targetMs, bool rows) const {
+    if (!count) return;
+    printf("%s: %llu frames, mean %.3f ms (%.1f fps), jitter (stddev) %.3f ms, min %.3f p50 %.3f p99 %.3f p99.9 %.3f max %.3f ms\n",
+        title, (unsigned long long)count, meanMs(), 1000.0 / meanMs(), stddevMs(), minMs, percentileMs(0.5), percentileMs(0.99),
+        percentileMs(0.999), maxMs);
+    if (!rows) return;
+
+    // merge bins so the populated range prints in at most ~24 rows
+    int lo = 0, hi = BINS - 1;
+    while (!bins[lo]) lo++;
+    while (!bins[hi]) hi--;
+    int step = (hi - lo) / 24 + 1;
+    uint32_t peak = 0;
+    for (int b = lo; b <= hi; b += step) {
+        uint32_t n = 0;
+        for (int k = b; k < b + step && k <= hi; k++) n += bins[k];
+        if (n > peak) peak = n;
+    }
+    for (int b = lo; b <= hi; b += step) {
+        uint32_t n = 0;
+        for (int k = b; k < b + step && k <= hi; k++) n += bins[k];
+        double from = b * BIN_MS, to = (b + step) * BIN_MS;
+        bool target = targetMs > 0.0 && targetMs >= from && targetMs < to;
+        int bar = (int)(40.0 * n / peak + 0.5);
+        printf("  %6.2f-%-6.2f %8u %c %s\n", from, b + step > BINS - 1 ? maxMs : to, n, target ? '*' : ' ', std::string(bar, '#').c_str());
+    }
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+    if (fineTimer) timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::init(PresentMode mode, double capHz, int spinUs) {
+    presentMode = mode;
+    periodNs = capHz > 0.0 ? (int64_t)(1e9 / capHz) : 0;
+    if (presentMode == PresentMode::Capped && periodNs <= 0) presentMode = PresentMode::Uncapped;
+    spinNs = (int64_t)(spinUs < 0 ? 0 : spinUs) * 1000;
+    deadlineNs = 0;
+#ifdef _WIN32
+    // default sleeps round up to the 15.6 ms system tick, far too coarse for a limiter
+    if (presentMode == PresentMode::Capped && !fineTimer) fineTimer = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+}
+
+int FramePacer::swapInterval() const {
+    switch (presentMode) {
+    case PresentMode::Vsync: return 1;
+    case PresentMode::Adaptive: return -1;
+    default: return 0;
+    }
+}
+
+void FramePacer::waitForFrame() {
+    if (presentMode != PresentMode::Capped) return;
+    int64_t now = profNowNs();
+    // a frame more than a period late starts the schedule over instead of rushing to catch up
+    if (!deadlineNs || now - deadlineNs > periodNs) deadlineNs = now;
+
+    int64_t sleepUntil = deadlineNs - spinNs;
+    if (now < sleepUntil) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(sleepUntil - now));
+        int64_t woke = profNowNs();
+        sleptNs += woke - now;
+        now = woke;
+    }
+    int64_t spinStart = now;
+    while (now < deadlineNs) {
+        std::this_thread::yield();
+        now = profNowNs();
+    }
+    spunNs += now - spinStart;
+    deadlineNs += periodNs;
+}
+
+void FramePacer::framePresented() {
+    int64_t now = profNowNs();
+    if (lastPresentNs) hist.add((now - lastPresentNs) * 1e-6);
+    lastPresentNs = now;
+}
+
+void FramePacer::printReport(bool histogramRows) const {
+    char title[96];
+    if (presentMode == PresentMode::Capped) snprintf(title, sizeof(title), "Frame pacing (capped %.1f Hz)", 1e9 / periodNs);
+    else snprintf(title, sizeof(title), "Frame pacing (%s)", presentModeName(presentMode));
+    hist.print(title, targetMs(), histogramRows);
+    if (presentMode == PresentMode::Capped && hist.count) {
+        printf("  limiter: %.1f ms asleep, %.1f ms spinning (%.0f%% of the wait spent on the CPU)\n", sleptMs(), spunMs(),
+            100.0 * spunNs / (double)(sleptNs + spunNs > 0 ? sleptNs + spunNs : 1));
+    }
+}
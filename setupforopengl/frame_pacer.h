@@ -0,0 +1,72 @@
+// frame_pacer.h
+// Hop Hop Bunny - present modes and frame pacing
+// How often a frame is presented: locked to the display (vsync), as fast as possible
+// (uncapped), at a fixed rate set by a CPU limiter (capped), or vsync that lets a late frame
+// tear instead of waiting a whole refresh (adaptive). The limiter sleeps until shortly before
+// the frame's deadline and spins the rest: sleeping saves power but wakes up late by up to a
+// scheduler tick, spinning hits the deadline to a few microseconds. spinUs trades one for the
+// other. The wait is at the top of the frame, before input is read, so the frame that follows
+// starts from the freshest input.
+// Every present lands in a histogram of present-to-present intervals, the jitter report.
+// No GL/GLFW here; the caller applies swapInterval().
+
+#pragma once
+
+#include <cstdint>
+
+enum class PresentMode { Vsync, Uncapped, Capped, Adaptive };
+
+const char* presentModeName(PresentMode m);
+bool parsePresentMode(const char* s, PresentMode& m);
+
+// Present-to-present intervals in BIN_MS bins; the last bin takes everything longer.
+struct PacingHistogram {
+    static const int BINS = 400;
+    static constexpr double BIN_MS = 0.125;   // up to 50 ms
+
+    uint32_t bins[BINS] = {};
+    uint64_t count = 0;
+    double sumMs = 0.0, sumSqMs = 0.0, minMs = 0.0, maxMs = 0.0;
+
+    void add(double ms);
+    double meanMs() const { return count ? sumMs / count : 0.0; }
+    double stddevMs() const;
+    double percentileMs(double q) const;   // upper edge of the bin, so within BIN_MS
+    // Summary line, then (rows) the non-empty part of the histogram; targetMs (0 = none) marks
+    // the intended interval.
+    void print(const char* title, double targetMs, bool rows) const;
+};
+
+class FramePacer {
+public:
+    ~FramePacer();
+
+    void init(PresentMode mode, double capHz, int spinUs);
+
+    PresentMode mode() const { return presentMode; }
+    // For glfwSwapInterval: 1 vsync, 0 uncapped/capped, -1 adaptive (needs *_EXT_swap_control_tear).
+    int swapInterval() const;
+    // Falls back to vsync, for when adaptive is not supported.
+    void useVsync() { presentMode = PresentMode::Vsync; }
+    double targetMs() const { return presentMode == PresentMode::Capped ? periodNs * 1e-6 : 0.0; }
+
+    // Capped only: waits for this frame's slot. Call at the top of the frame.
+    void waitForFrame();
+    // Call right after the swap.
+    void framePresented();
+
+    const PacingHistogram& histogram() const { return hist; }
+    void resetStats() { hist = PacingHistogram(); sleptNs = spunNs = 0; }
+    double sleptMs() const { return sleptNs * 1e-6; }
+    double spunMs() const { return spunNs * 1e-6; }
+    void printReport(bool histogramRows) const;
+
+private:
+    PresentMode presentMode = PresentMode::Vsync;
+    int64_t periodNs = 0, spinNs = 0;
+    int64_t deadlineNs = 0;          // when the next capped frame may start
+    int64_t lastPresentNs = 0;
+    int64_t sleptNs = 0, spunNs = 0;
+    bool fineTimer = false;          // raised the OS timer resolution, undo on exit
+    PacingHistogram hist;
+};
@@ -0,0 +1,195 @@
+// game_sim.cpp
+// Hop Hop Bunny - fixed-step simulation core
+
+#include "game_sim.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The spawn, scroll and collision scopes feed the game's frame profiler, which is main thread
+// only. The tools step GameSim on pool threads and don't link profiler.cpp, so only a build
+// with HHB_SIM_PROFILE (the game's project) gets them.
+#if HHB_SIM_PROFILE
+#include "profiler.h"
+#define SIM_SCOPE(phase) PROFILE_SCOPE(phase)
+#else
+#define SIM_SCOPE(phase) ((void)0)
+#endif
+
+GameSim::GameSim(const GameParams& p, uint32_t seed) : params(p) {
+    reset(seed);
+}
+
+int maxLivePipes(const GameParams& P) {
+    // a spawn needs timeSinceSpawn > spawnInterval, so spawns are at least this many ticks apart
+    int ticks = (int)(P.spawnInterval / P.fixedDt);
+    float spacing = P.pipeSpeed * P.fixedDt * (float)std::max(ticks, 1);
+    if (spacing <= 0.0f) return 4096;   // pipes never leave; just a sane start
+    return std::min((int)std::ceil((2.7f + P.pipeWidth) / spacing) + 2, 1 << 16);
+}
+
+bool scriptedFlap(const GameSim& sim) {
+    const GameParams& P = sim.params;
+    float target = 0.0f;
+    for (int i = sim.nearPipe; i < sim.pipes.size(); i++) {   // the ones before it are behind
+        const Pipe& p = sim.pipes[i];
+        if (p.x + p.width * 0.5f >= P.birdX - P.birdRadius) { target = p.gapY; break; }
+    }
+    return sim.birdY < target - 0.06f && sim.birdVel <= 0.0f;
+}
+
+void GameSim::reset(uint32_t seed) {
+    birdY = 0.0f; birdVel = 0.0f;
+    pipes.clear();
+    pipes.reserve(maxLivePipes(params));   // no-op after the first reset with the same params
+    nearPipe = 0;
+    timeSinceSpawn = 0.0f;
+    score = 0;
+    dead = false;
+    firstFlapDone = false;
+    tick = 0;
+    rng = Pcg32(seed, COURSE_STREAM);
+    prevBirdY = birdY;
+    prevScroll = 0.0f;
+}
+
+float GameSim::nextUnit() {
+    return rng.unit();
+}
+
+void generateCourse(const GameParams& P, uint32_t seed, uint64_t first, int count, float* gapY) {
+    Pcg32 g(seed, COURSE_STREAM);
+    g.advance(first);
+    for (int i = 0; i < count; i++) gapY[i] = spawnGapY(P, g.unit());
+}
+
+uint32_t GameSim::step(const InputFrame& in) {
+    const GameParams& P = params;
+    const float dt = P.fixedDt;
+    uint32_t ev = SIM_EV_NONE;
+
+    prevBirdY = birdY;
+    prevScroll = 0.0f;
+
+    if (in.flap && !dead) {
+        birdVel = +P.flapStrength;
+        firstFlapDone = true;
+        ev |= SIM_EV_FLAP;
+    }
+
+    if (firstFlapDone) {
+        birdVel += P.gravity * dt;
+        birdY += birdVel * dt;
+    }
+
+    // the hitbox's reach above and below the centre (the same float as before for the square)
+    const float reachUp = P.birdMask ? P.birdMask->extTop : P.birdRadius;
+    const float reachDown = P.birdMask ? P.birdMask->extBottom : P.birdRadius;
+    if (birdY + reachUp > 1.0f) {
+        birdY = 1.0f - reachUp;
+        birdVel = 0;
+    }
+
+    if (birdY - reachDown < -1.0f) {
+        birdY = -1.0f + reachDown;
+        if (!P.godMode) {
+            if (!dead) ev |= SIM_EV_DIED;
+            dead = true;
+        }
+    }
+
+    const bool moving = !dead;
+    if (moving) {
+        SIM_SCOPE(PROF_SPAWN);
+        timeSinceSpawn += dt;
+        if (timeSinceSpawn > P.spawnInterval) {
+            timeSinceSpawn = 0.0f;
+            Pipe p;
+            p.x = 1.2f;
+            p.width = P.pipeWidth;
+            p.gapSize = P.pipeGapSize;
+            p.gapY = spawnGapY(P, nextUnit());
+            p.scored = false;
+            pipes.push_back(p);
+        }
+        prevScroll = P.pipeSpeed * dt;
+    }
+
+    // Scroll every pipe, score the ones that just went past the bird, cull from the front.
+    // A dead bird scrolls by 0, which leaves x unchanged bit for bit.
+    {
+        SIM_SCOPE(PROF_SCROLL);
+        const float scroll = moving ? P.pipeSpeed * dt : 0.0f;
+        const float birdX = P.birdX;   // locals: stores to p.x could otherwise alias params
+        const int n = pipes.size();
+        for (int i = 0; i < n; i++) pipes[i].x -= scroll;
+
+        // everything before nearPipe is already scored, and the first pipe still ahead of the
+        // bird ends the run of candidates
+        int scored = 0;
+        for (int i = nearPipe; i < n && pipes[i].x + pipes[i].width * 0.5f < birdX; i++) {
+            if (!pipes[i].scored) { pipes[i].scored = true; scored++; }
+        }
+        if (scored) { score += scored; ev |= SIM_EV_SCORED; }
+
+        while (!pipes.empty() && pipes.front().x + pipes.front().width < -1.5f) {
+            pipes.pop_front();
+            if (nearPipe > 0) nearPipe--;
+        }
+    }
+
+    SIM_SCOPE(PROF_COLLISION);
+    if (hitsPipe() && !P.godMode) {
+        if (!dead) ev |= SIM_EV_DIED;
+        dead = true;
+    }
+
+    tick++;
+    return ev;
+}
+
+// Pipes all scroll at one speed and share one width, so they stay sorted by x and both edges
+// only ever move left. A pipe whose right edge is further left of the bird than one tick of
+// scrolling can never touch it again (nearPipe only moves forward, O(1) amortized per tick),
+// and the first pipe whose left edge is still right of the bird ends the search, so only the
+// one or two pipes under the bird are tested however many are alive.
+// The old loop scaled both sides of the x test by the framebuffer aspect, which never changes
+// the result, so collision is done directly in NDC and stays resolution independent.
+bool GameSim::hitsPipe() {
+    const GameParams& P = params;
+    const CollisionMask* mask = P.birdMask;
+    const float birdL = P.birdX - (mask ? mask->extLeft : P.birdRadius);
+    const float birdR = P.birdX + (mask ? mask->extRight : P.birdRadius);
+    const float reach = P.pipeSpeed * P.fixedDt;   // the most a pipe moves in one tick
+    const float invScroll = prevScroll > 0.0f ? 1.0f / prevScroll : 0.0f;
+    const int n = pipes.size();
+    while (nearPipe < n && birdL - (pipes[nearPipe].x + pipes[nearPipe].width * 0.5f) > reach) nearPipe++;
+    for (int i = nearPipe; i < n; i++) {
+        const Pipe& p = pipes[i];
+        if (birdR < p.x - p.width * 0.5f) break;   // this one and everything after it is ahead
+        bool hit = mask ? pipeMaskHit(P, p, prevBirdY, birdY, prevScroll, invScroll) : pipeSweptHit(P, p, prevBirdY, birdY, prevScroll, invScroll);
+        if (hit) return true;
+    }
+    return false;
+}
+
+bool pipeMaskHit(const GameParams& P, const Pipe& p, float y0, float y1, float scroll, float invScroll) {
+    const CollisionMask& m = *P.birdMask;
+    if (!boxSweptHit(P, p, y0, y1, scroll, invScroll, m.extLeft, m.extRight, m.extTop, m.extBottom)) return false;
+
+    const float pl = p.x - p.width * 0.5f, pr = p.x + p.width * 0.5f;
+    const float gt = p.gapY + p.gapSize * 0.5f, gb = p.gapY - p.gapSize * 0.5f;
+    const float dy = y1 - y0;
+
+    // more sub-steps than cells only buys precision the mask doesn't have
+    float cells = std::max(scroll * m.invCellW, std::fabs(dy) * m.invCellH);
+    int steps = std::min(std::max((int)std::ceil(cells), 1), CollisionMask::SIZE);
+    const float stepX = scroll / steps, stepY = std::fabs(dy) / steps;
+    for (int i = 0; i < steps; i++) {
+        float t = (float)i / steps;
+        float off = scroll * (1.0f - t);                     // pipe right of x at the sub-step start
+        float y = y0 + dy * (t + 0.5f / steps);              // bird at the sub-step middle
+        if (m.hitsPipe(P.birdX, y, pl + off - stepX, pr + off, gb + stepY * 0.5f, gt - stepY * 0.5f)) return true;
+    }
+    return false;
+}
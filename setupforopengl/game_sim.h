@@ -0,0 +1,147 @@
+// game_sim.h
+// Hop Hop Bunny - fixed-step simulation core
+// All game rules (bird physics, pipe spawning/scrolling, scoring, collision) live here,
+// independent of GLFW/GL, so the same rules can run inside the window or headless.
+
+#pragma once
+
+#include "collision_mask.h"
+#include "pcg32.h"
+#include "ring_buffer.h"
+
+#include <cstdint>
+
+struct Pipe { float x; float gapY; float width; float gapSize; bool scored = false; };
+
+// Pipes oldest first; reset() sizes it for maxLivePipes(), so it never grows while stepping.
+typedef RingBuffer<Pipe> PipeRing;
+
+struct GameParams {
+    float birdX = -0.4f;
+    float birdRadius = 0.012f;
+    float pipeSpeed = 0.3f;
+    float spawnInterval = 1.6f;
+    float pipeWidth = 0.12f;
+    float pipeGapSize = 0.50f;
+    float flapStrength = 0.60f;
+    float gravity = -2.30f;
+    float fixedDt = 1.0f / 120.0f;   // simulation tick length in seconds
+    bool godMode = false;            // pipes and the floor never end the run (stress testing)
+    const CollisionMask* birdMask = nullptr;   // pixel hitbox; null = a square of birdRadius
+};
+
+// The bunny sprite in NDC: 90x90 px in the 1280x720 window. Pixel hitboxes cover this frame.
+const float BUNNY_HALF_W = 45.0f / 640.0f, BUNNY_HALF_H = 45.0f / 360.0f;
+
+// Bump when a rule change makes the same inputs play out differently; replays carry it in
+// their build hash.
+const uint32_t GAME_SIM_REVISION = 1;
+
+// PCG stream the pipe course (gap heights) is drawn from; pipe k of a run takes draw k.
+const uint64_t COURSE_STREAM = 1;
+
+// Gap centre for a new pipe from a uniform sample u in [0,1).
+inline float spawnGapY(const GameParams& P, float u) {
+    float margin = 0.2f;
+    float halfGap = P.pipeGapSize * 0.5f;
+    return -1.0f + margin + halfGap + u * (2.0f - 2.0f * margin - P.pipeGapSize);
+}
+
+// Swept test of a box around the bird against one pipe over the last tick. The box reaches
+// left/right/up/down from the bird's centre. The bird went from y0 to y1 in a straight line
+// (which is how the integrator moves it) while the pipe moved left by scroll to where it is
+// now. At time s in [0,1] the pipe was u = scroll * (1 - s) right of here, so the box
+// overlaps it in x for u in [ua, ub]; y is linear in u, so the highest and lowest points over
+// that window are at its ends. Catches pipes that the bird passed through between two end
+// positions that were both clear. With scroll 0 (invScroll 0) it is the plain end-position
+// test. sim_batch_kernel.h repeats these operations one for one for the square.
+inline bool boxSweptHit(const GameParams& P, const Pipe& p, float y0, float y1, float scroll, float invScroll,
+    float left, float right, float up, float down) {
+    float pl = p.x - p.width * 0.5f;
+    float pr = p.x + p.width * 0.5f;
+    float ua = (P.birdX - left) - pr;
+    float ub = (P.birdX + right) - pl;
+    if (ua < 0.0f) ua = 0.0f;
+    if (ub > scroll) ub = scroll;
+    if (ub < ua) return false;
+
+    float dy = y1 - y0;
+    float ya = y1 - dy * (ua * invScroll);
+    float yb = y1 - dy * (ub * invScroll);
+    float hi = ya > yb ? ya : yb;
+    float lo = ya > yb ? yb : ya;
+    float gt = p.gapY + p.gapSize * 0.5f;
+    float gb = p.gapY - p.gapSize * 0.5f;
+    return !((hi + up < gt) && (lo - down > gb));
+}
+
+// The square birdRadius hitbox.
+inline bool pipeSweptHit(const GameParams& P, const Pipe& p, float y0, float y1, float scroll, float invScroll) {
+    const float r = P.birdRadius;
+    return boxSweptHit(P, p, y0, y1, scroll, invScroll, r, r, r, r);
+}
+
+// Same sweep for a pixel hitbox (params.birdMask must be set). The mask's solid bounds go
+// through boxSweptHit first, which clears almost every pipe. Otherwise the tick is cut into
+// sub-steps of at most about one mask cell of motion; each sub-step tests the pipe widened by
+// its x travel and the gap narrowed by the bird's y travel, so nothing is skipped and a hit
+// comes at most one cell early.
+bool pipeMaskHit(const GameParams& P, const Pipe& p, float y0, float y1, float scroll, float invScroll);
+
+// Everything the player can do during one tick.
+struct InputFrame { bool flap = false; };
+
+// Bits returned by GameSim::step so the caller can react (sounds, window title, buttons).
+enum SimEvent : uint32_t {
+    SIM_EV_NONE = 0,
+    SIM_EV_FLAP = 1u << 0,
+    SIM_EV_SCORED = 1u << 1,
+    SIM_EV_DIED = 1u << 2,
+};
+
+struct GameSim {
+    GameParams params;
+
+    float birdY = 0.0f, birdVel = 0.0f;
+    PipeRing pipes;
+    int nearPipe = 0;   // pipes before this index are behind the bird for good; 0 is always safe
+    float timeSinceSpawn = 0.0f;
+    int score = 0;
+    bool dead = false;
+    bool firstFlapDone = false;
+    uint32_t tick = 0;
+    Pcg32 rng;   // the course: seeded by reset(), one draw per spawned pipe
+
+    // state from the start of the last tick, used for render interpolation
+    float prevBirdY = 0.0f;
+    float prevScroll = 0.0f;
+
+    explicit GameSim(const GameParams& p = GameParams(), uint32_t seed = 1);
+
+    // Also sizes the pipe ring for every pipe that can be alive at once.
+    void reset(uint32_t seed);
+
+    // Advance exactly one tick of params.fixedDt. Returns a mask of SimEvent bits.
+    uint32_t step(const InputFrame& in);
+
+    // alpha in [0,1]: 0 = previous tick, 1 = current tick
+    float renderBirdY(float alpha) const { return prevBirdY + (birdY - prevBirdY) * alpha; }
+    float renderPipeX(const Pipe& p, float alpha) const { return p.x + prevScroll * (1.0f - alpha); }
+
+    // Did the bird touch a pipe during the last tick (prevBirdY to birdY, pipes moved by
+    // prevScroll)? Broadphase plus pipeSweptHit; advances nearPipe. Called by step().
+    bool hitsPipe();
+
+    float nextUnit();   // uniform [0,1) from the sim's own generator
+};
+
+// Gap centres of pipes [first, first + count) of the course GameSim plays with this seed and
+// these params, without running the sim. Any range can be made on its own (the generator
+// jumps to `first`), so a level can be pre-generated in bulk or streamed in chunks.
+void generateCourse(const GameParams& P, uint32_t seed, uint64_t first, int count, float* gapY);
+
+// Most pipes that can be alive at once with these params (spawned at x 1.2, gone past -1.5).
+int maxLivePipes(const GameParams& P);
+
+// Scripted player: flap when below the centre of the next gap and not already rising.
+bool scriptedFlap(const GameSim& sim);
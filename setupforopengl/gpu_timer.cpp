@@ -0,0 +1,56 @@
+// gpu_timer.cpp
+// Hop Hop Bunny - GPU time per render pass
+
+#include "gpu_timer.h"
+
+#include <cstdio>
+
+bool GpuTimer::init() {
+    ok = false;
+    if (!glGenQueries || !glGetQueryiv || !glGetQueryObjectui64v) return false;
+    GLint bits = 0;
+    glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &bits);
+    if (glGetError() != GL_NO_ERROR || bits == 0) {
+        printf("GPU timer queries not available, GPU pass times off\n");
+        return false;
+    }
+    for (Slot& s : slots) glGenQueries(PROF_PHASE_COUNT, s.q);
+    ok = true;
+    return true;
+}
+
+void GpuTimer::destroy() {
+    if (!ok) return;
+    pass(-1);
+    for (Slot& s : slots) glDeleteQueries(PROF_PHASE_COUNT, s.q);
+    ok = false;
+}
+
+void GpuTimer::beginFrame() {
+    if (!ok) return;
+    pass(-1);
+    cur = (cur + 1) % FRAMES;
+    Slot& s = slots[cur];
+    for (int p = 0; p < PROF_PHASE_COUNT; p++) {
+        if (!s.issued[p]) continue;
+        s.issued[p] = false;
+        GLint ready = 0;
+        glGetQueryObjectiv(s.q[p], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) { lost++; continue; }   // reusing the query discards it
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(s.q[p], GL_QUERY_RESULT, &ns);
+        gProfiler.recordGpu(s.frame, p, (float)(ns * 1e-6));
+    }
+    s.frame = gProfiler.frameIndex();
+    inFrame = active();
+}
+
+void GpuTimer::pass(int phase) {
+    if (open >= 0) { glEndQuery(GL_TIME_ELAPSED); open = -1; }
+    if (phase < 0 || !inFrame) return;
+    Slot& s = slots[cur];
+    if (s.issued[phase]) return;
+    glBeginQuery(GL_TIME_ELAPSED, s.q[phase]);
+    s.issued[phase] = true;
+    open = phase;
+}
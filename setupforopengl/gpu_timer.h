@@ -0,0 +1,51 @@
+// gpu_timer.h
+// Hop Hop Bunny - GPU time per render pass
+// GL_TIME_ELAPSED queries around each pass, one set per frame in flight (FRAMES). A set is
+// read back when its slot comes round again, FRAMES frames later, and only if the driver says
+// the result is available, so the CPU never waits on the GPU; late results are dropped and
+// counted. Results go into gProfiler under the frame that issued them.
+// Drivers without timer queries (GL_QUERY_COUNTER_BITS 0, e.g. some llvmpipe builds) leave it
+// switched off and every call a no-op.
+
+#pragma once
+
+#include "profiler.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+class GpuTimer {
+public:
+    static const int FRAMES = 3;
+
+    // Needs a current GL context. Returns false (and stays off) without timer queries.
+    bool init();
+    void destroy();
+
+    bool supported() const { return ok; }
+    bool active() const { return ok && gProfiler.enabled; }   // timing only while profiling
+
+    // Top of the frame: collect the slot's results from FRAMES frames ago and reuse it.
+    void beginFrame();
+
+    // Ends the open pass (if any) and starts timing phase; phase < 0 just ends. Passes can't
+    // nest (one GL_TIME_ELAPSED query at a time) and each phase is timed once per frame.
+    void pass(int phase);
+
+    uint64_t dropped() const { return lost; }
+
+private:
+    struct Slot {
+        GLuint q[PROF_PHASE_COUNT] = {};
+        bool issued[PROF_PHASE_COUNT] = {};
+        uint64_t frame = 0;
+    };
+
+    Slot slots[FRAMES];
+    int cur = 0;
+    int open = -1;          // phase with a running query
+    bool ok = false;
+    bool inFrame = false;   // queries may be issued this frame
+    uint64_t lost = 0;
+};
@@ -0,0 +1,1069 @@
+// headless.cpp
+// Hop Hop Bunny - headless batch simulation runner
+// Runs many independent episodes of GameSim with a scripted or random flap policy and
+// reports throughput and score distribution. Links only the simulation (no glad/GLFW/winmm).
+//
+// Build (Linux):  g++ -O2 -std=c++17 -c sim_batch_avx2.cpp -mavx2
+//                 g++ -O2 -std=c++17 -c audio_mix_avx2.cpp -mavx2
+//                 g++ -O2 -std=c++17 -pthread -Idependencies/include headless.cpp game_sim.cpp collision_mask.cpp replay.cpp sim_batch.cpp
+//                     work_pool.cpp audio.cpp audio_mix.cpp alloc_hook.cpp
+//                     sim_batch_avx2.o audio_mix_avx2.o -o headless
+// (-std=c++17 rather than gnu++17 keeps GCC from contracting a*b+c into FMA, which the
+//  bit-exact batch check relies on)
+// Usage:          ./headless --episodes 100000 --policy scripted --gap 0.45
+//                 ./headless --batch --episodes 1000000
+//                 ./headless --verify-batch
+//                 ./headless --scaling --episodes 2000000
+//                 ./headless --render-audio out.wav --seed 6 --golden golden/seed6.wav
+//                 ./headless --bench-mix
+//                 ./headless --alloc-check 10000
+//                 ./headless --bench-pipes
+//                 ./headless --bench-broadphase
+//                 ./headless --fuzz-ccd 2000
+//                 ./headless --course 10000000 --seed 42 --threads 0
+//                 ./headless --bench-mask --mask "bunny sequence/bunny_sequence 1.png" --mask "bunny sequence/bunny_sequence 2.png"
+//                 ./headless --write-replay run.hhbr --seed 42
+//                 ./headless --verify-replay run.hhbr --verify-replay other.hhbr
+//                 ./headless --bench-replay
+
+#include "alloc_hook.h"
+#include "audio.h"
+#include "game_sim.h"
+#include "replay.h"
+#include "sim_batch.h"
+#include "work_pool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+enum class Policy { Scripted, Random };
+enum class Mode { Episodes, Batch, VerifyBatch, Scaling, RenderAudio, BenchMix, AllocCheck, BenchPipes, BenchBroadphase, FuzzCcd, BenchMask, Course, WriteReplay, VerifyReplay, BenchReplay };
+
+struct RunOptions {
+    Mode mode = Mode::Episodes;
+    bool batch = false;              // step SIM_BATCH_LANES worlds at once
+    int threads = 1;                 // 0 = all hardware threads
+    GameParams params;
+    long long episodes = 10000;
+    uint32_t maxTicks = 120 * 600;   // 10 minutes of game time
+    uint32_t seed = 1;
+    Policy policy = Policy::Scripted;
+    float flapChance = 0.04f;        // random policy: probability of a flap per tick
+
+    // --render-audio
+    std::string renderPath;
+    std::string inputsPath;          // flap ticks to play instead of the policy
+    std::string saveInputsPath;      // write the flap ticks that were used
+    std::string goldenPath;
+    std::string soundDir = "sounds";
+    int goldenTolerance = 0;         // max per-sample difference still accepted
+
+    int allocFrames = 10000;         // --alloc-check
+    int fuzzWorlds = 2000;           // --fuzz-ccd
+    long long coursePipes = 0;       // --course
+    std::string replayOut = "bench_replay.hhbr";   // --write-replay, --bench-replay's file
+    std::vector<std::string> replayPaths;  // --verify-replay
+
+    std::vector<std::string> maskPaths;   // --mask: pixel hitbox from the union of these PNGs
+    CollisionMask mask;                   // params.birdMask points here once loaded
+};
+
+struct EpisodeResult { int score; uint32_t ticks; };
+
+// splitmix-style finalizer, used to derive per-episode seeds from one run seed.
+// Every episode gets its own stream from (run seed, episode index), so results do not depend
+// on which worker ran the episode or in what order.
+static uint32_t mixSeed(uint32_t a, uint32_t b) {
+    uint64_t z = ((uint64_t)a << 32 | b) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (uint32_t)z | 1u;
+}
+
+static bool randomFlap(uint32_t& policyRng, float chance) {
+    policyRng ^= policyRng << 13; policyRng ^= policyRng >> 17; policyRng ^= policyRng << 5;
+    return (float)(policyRng >> 8) * (1.0f / 16777216.0f) < chance;
+}
+
+static EpisodeResult runEpisode(const RunOptions& o, GameSim& sim, uint32_t episodeSeed) {
+    sim.reset(episodeSeed);
+    uint32_t policyRng = episodeSeed ^ 0xA5A5A5A5u;
+    if (!policyRng) policyRng = 1;
+
+    while (!sim.dead && sim.tick < o.maxTicks) {
+        InputFrame in;
+        in.flap = o.policy == Policy::Scripted ? scriptedFlap(sim) : randomFlap(policyRng, o.flapChance);
+        sim.step(in);
+    }
+    return { sim.score, sim.tick };
+}
+
+// Runs the same episodes as the one-world loop (same seeds, same policy), SIM_BATCH_LANES at a time.
+// Each lane picks up the next episode in [begin, end) as soon as its current one ends.
+static void runBatch(const RunOptions& o, std::vector<EpisodeResult>& results, long long begin, long long end) {
+    SimBatch* b = new SimBatch();
+    b->init(o.params, 1);
+
+    long long episodeOf[SIM_BATCH_LANES];
+    uint32_t policyRng[SIM_BATCH_LANES];
+    long long next = begin;
+    auto startLane = [&](int l) {
+        episodeOf[l] = next < end ? next++ : -1;
+        uint32_t seed = mixSeed(o.seed, (uint32_t)(episodeOf[l] < 0 ? 0 : episodeOf[l]));
+        b->resetLane(l, seed);
+        policyRng[l] = (seed ^ 0xA5A5A5A5u) ? (seed ^ 0xA5A5A5A5u) : 1;
+        if (episodeOf[l] < 0) b->dead[l] = 0xFFFFFFFFu;   // idle lane
+    };
+    for (int l = 0; l < SIM_BATCH_LANES; l++) startLane(l);
+
+    alignas(32) uint8_t flap[SIM_BATCH_LANES], died[SIM_BATCH_LANES];
+    int running = SIM_BATCH_LANES;
+    while (running > 0) {
+        if (o.policy == Policy::Scripted) b->step(b->scriptedFlap, died);   // worked out by the last step
+        else {
+            for (int l = 0; l < SIM_BATCH_LANES; l++) flap[l] = randomFlap(policyRng[l], o.flapChance);
+            b->step(flap, died);
+        }
+
+        running = 0;
+        for (int l = 0; l < SIM_BATCH_LANES; l++) {
+            if (episodeOf[l] < 0) continue;
+            if (b->dead[l] || b->tick[l] >= o.maxTicks) {
+                results[(size_t)episodeOf[l]] = { b->score[l], b->tick[l] };
+                startLane(l);
+            }
+            if (episodeOf[l] >= 0) running++;
+        }
+    }
+    delete b;
+}
+
+// Runs all episodes on the pool in chunks; idle workers steal chunks from busy ones.
+// About TASKS_PER_WORKER chunks per worker, so every worker has work and stealing can even out
+// long episodes; the floor keeps tiny runs from paying a task per episode, and a batch chunk
+// fills its lanes a few times over.
+static void runEpisodes(const RunOptions& o, WorkPool& pool, std::vector<EpisodeResult>& results) {
+    const long long TASKS_PER_WORKER = 8;
+    std::vector<GameSim> sims((size_t)pool.size(), GameSim(o.params));
+    long long grain = std::max<long long>(o.episodes / (pool.size() * TASKS_PER_WORKER), o.batch ? 4 * SIM_BATCH_LANES : 16);
+    pool.parallelFor(o.episodes, grain, [&](long long b, long long e, int worker) {
+        if (o.batch) {
+            runBatch(o, results, b, e);
+            return;
+        }
+        GameSim& sim = sims[(size_t)worker];
+        for (long long i = b; i < e; i++) results[(size_t)i] = runEpisode(o, sim, mixSeed(o.seed, (uint32_t)i));
+    });
+}
+
+// Same episode set at 1, 2, 4, ... threads up to the pool size; efficiency = speedup / threads.
+static void runScaling(const RunOptions& o) {
+    int maxThreads = o.threads > 0 ? o.threads : (int)std::thread::hardware_concurrency();
+    if (maxThreads < 1) maxThreads = 1;
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    std::printf("scaling: %lld episodes, policy=%s, %s\n", o.episodes, o.policy == Policy::Scripted ? "scripted" : "random",
+        o.batch ? simBatchPathName(simBatchBestPath()) : "single");
+    std::printf("  threads      time   episodes/s   Msteps/s  speedup  efficiency  steals\n");
+
+    std::vector<EpisodeResult> results((size_t)o.episodes);
+    double base = 0.0;
+    for (int t : counts) {
+        WorkPool pool(t);
+        auto t0 = Clock::now();
+        runEpisodes(o, pool, results);
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        unsigned long long steps = 0;
+        for (const EpisodeResult& r : results) steps += r.ticks;
+        double rate = o.episodes / seconds;
+        if (t == 1) base = rate;
+        double speedup = rate / base;
+        std::printf("  %7d  %7.3f s  %11.0f  %9.2f  %6.2fx  %9.1f%%  %6llu\n",
+            t, seconds, rate, steps / seconds / 1e6, speedup, 100.0 * speedup / t, (unsigned long long)pool.stealCount());
+    }
+}
+
+static bool sameBits(float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; }
+
+static bool sameWorld(const GameSim& a, const GameSim& b) {
+    if (!sameBits(a.birdY, b.birdY) || !sameBits(a.birdVel, b.birdVel) || !sameBits(a.timeSinceSpawn, b.timeSinceSpawn)) return false;
+    if (a.score != b.score || a.dead != b.dead || a.firstFlapDone != b.firstFlapDone || a.tick != b.tick || a.rng != b.rng) return false;
+    if (a.pipes.size() != b.pipes.size()) return false;
+    for (int i = 0; i < a.pipes.size(); i++) {
+        if (!sameBits(a.pipes[i].x, b.pipes[i].x) || !sameBits(a.pipes[i].gapY, b.pipes[i].gapY) || a.pipes[i].scored != b.pipes[i].scored) return false;
+    }
+    return true;
+}
+
+// Steps every available batch path and one GameSim per lane side by side with random input
+// and checks that all of them stay bit-identical.
+static bool verifyBatch(const RunOptions& o) {
+    const SimBatchPath paths[] = { SimBatchPath::Scalar, SimBatchPath::SSE2, SimBatchPath::AVX2 };
+    std::vector<SimBatch*> batches;
+    std::vector<SimBatchPath> used;
+    for (SimBatchPath p : paths) {
+        if (!simBatchPathAvailable(p)) { std::printf("  %-6s not available on this CPU/build, skipped\n", simBatchPathName(p)); continue; }
+        SimBatch* b = new SimBatch();
+        if (!b->init(o.params, o.seed)) { std::fprintf(stderr, "params do not fit the batch pipe slots\n"); return false; }
+        batches.push_back(b);
+        used.push_back(p);
+    }
+
+    std::vector<GameSim> worlds(SIM_BATCH_LANES, GameSim(o.params));
+    for (int l = 0; l < SIM_BATCH_LANES; l++) worlds[l].reset(o.seed + (uint32_t)l);
+
+    uint32_t inputRng = o.seed | 1u;
+    uint32_t episodeSeed = o.seed + SIM_BATCH_LANES;
+    const long long ticks = std::max<long long>(o.episodes, 1) * 100;
+    alignas(32) uint8_t flap[SIM_BATCH_LANES], died[SIM_BATCH_LANES];
+    GameSim lane(o.params);
+    long long deaths = 0;
+
+    for (long long t = 0; t < ticks; t++) {
+        for (int l = 0; l < SIM_BATCH_LANES; l++) flap[l] = randomFlap(inputRng, o.flapChance);
+        for (size_t i = 0; i < batches.size(); i++) batches[i]->stepWith(used[i], flap, died);
+        for (int l = 0; l < SIM_BATCH_LANES; l++) { InputFrame in; in.flap = flap[l] != 0; worlds[l].step(in); }
+
+        for (size_t i = 1; i < batches.size(); i++) {
+            if (std::memcmp(batches[i], batches[0], sizeof(SimBatch)) != 0) {
+                std::printf("FAIL: %s and %s differ at tick %lld\n", simBatchPathName(used[i]), simBatchPathName(used[0]), t);
+                return false;
+            }
+        }
+        for (int l = 0; l < SIM_BATCH_LANES; l++) {
+            batches[0]->exportLane(l, lane);
+            if (!sameWorld(lane, worlds[l])) {
+                std::printf("FAIL: lane %d differs from GameSim at tick %lld\n", l, t);
+                return false;
+            }
+            if ((batches[0]->scriptedFlap[l] != 0) != scriptedFlap(worlds[l])) {
+                std::printf("FAIL: lane %d scripted flap differs from scriptedFlap() at tick %lld\n", l, t);
+                return false;
+            }
+            if (worlds[l].dead) {
+                deaths++;
+                episodeSeed++;
+                for (SimBatch* b : batches) b->resetLane(l, episodeSeed);
+                worlds[l].reset(episodeSeed);
+            }
+        }
+    }
+    for (SimBatch* b : batches) delete b;
+
+    std::printf("PASS: %lld ticks x %d lanes, %lld episodes, paths:", ticks, SIM_BATCH_LANES, deaths);
+    for (SimBatchPath p : used) std::printf(" %s", simBatchPathName(p));
+    std::printf(" and GameSim are bit-identical\n");
+    return true;
+}
+
+// Input file: one flap per line, the tick index it happens on (0 = first step). '#' comments.
+static bool readInputs(const std::string& path, std::vector<uint32_t>& ticks) {
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) return false;
+    char line[128];
+    while (std::fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        ticks.push_back((uint32_t)std::strtoul(line, nullptr, 10));
+    }
+    std::fclose(f);
+    std::sort(ticks.begin(), ticks.end());
+    return true;
+}
+
+static bool writeInputs(const std::string& path, const RunOptions& o, const std::vector<uint32_t>& ticks) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "# flap ticks, seed %u\n", o.seed);
+    for (uint32_t t : ticks) std::fprintf(f, "%u\n", t);
+    return std::fclose(f) == 0;
+}
+
+// Plays one episode and renders the game's sounds (hop on flap, death on death) sample-accurately
+// at the tick they happen, through the same mixer the game uses, into a WAV file.
+static bool renderAudio(const RunOptions& o) {
+    AudioEngine audio;
+    Sound hop, death;
+    std::string hopPath = o.soundDir + "/hop.wav", deathPath = o.soundDir + "/death.wav";
+    if (!loadWav(hopPath.c_str(), hop) || !loadWav(deathPath.c_str(), death)) {
+        std::fprintf(stderr, "cannot load %s / %s\n", hopPath.c_str(), deathPath.c_str());
+        return false;
+    }
+    int hopId = audio.addSound(hop), deathId = audio.addSound(death);
+    const int rate = 44100;
+    audio.init(AudioBackend::Manual, rate);
+
+    std::vector<uint32_t> inputs, used;
+    if (!o.inputsPath.empty() && !readInputs(o.inputsPath, inputs)) {
+        std::fprintf(stderr, "cannot read %s\n", o.inputsPath.c_str());
+        return false;
+    }
+
+    // same world and policy stream as episode 0 of the episode runner with this seed
+    uint32_t episodeSeed = mixSeed(o.seed, 0);
+    GameSim sim(o.params);
+    sim.reset(episodeSeed);
+    uint32_t policyRng = (episodeSeed ^ 0xA5A5A5A5u) ? (episodeSeed ^ 0xA5A5A5A5u) : 1;
+    size_t nextInput = 0;
+    std::vector<int16_t> pcm;
+    long long mixed = 0;
+    auto mixTo = [&](long long frame) {
+        if (frame <= mixed) return;
+        pcm.resize((size_t)frame * 2);
+        audio.mix(&pcm[(size_t)mixed * 2], (int)(frame - mixed));
+        mixed = frame;
+    };
+
+    int flaps = 0;
+    while (!sim.dead && sim.tick < o.maxTicks) {
+        InputFrame in;
+        if (!o.inputsPath.empty()) {
+            while (nextInput < inputs.size() && inputs[nextInput] < sim.tick) nextInput++;
+            in.flap = nextInput < inputs.size() && inputs[nextInput] == sim.tick;
+        }
+        else {
+            in.flap = o.policy == Policy::Scripted ? scriptedFlap(sim) : randomFlap(policyRng, o.flapChance);
+        }
+        if (in.flap) used.push_back(sim.tick);
+
+        // sounds start at the tick's time, so audio up to here is mixed before applying its events
+        mixTo((long long)((double)sim.tick * sim.params.fixedDt * rate + 0.5));
+        uint32_t ev = sim.step(in);
+        if (ev & SIM_EV_FLAP) { audio.play(hopId); flaps++; }
+        if (ev & SIM_EV_DIED) audio.play(deathId);
+    }
+    // let the last sounds ring out
+    mixTo(mixed + std::max(hop.frames, death.frames));
+
+    if (!saveWav(o.renderPath.c_str(), pcm.data(), (int)mixed, rate)) {
+        std::fprintf(stderr, "cannot write %s\n", o.renderPath.c_str());
+        return false;
+    }
+    if (!o.saveInputsPath.empty() && !writeInputs(o.saveInputsPath, o, used)) {
+        std::fprintf(stderr, "cannot write %s\n", o.saveInputsPath.c_str());
+        return false;
+    }
+
+    AudioStats st = audio.stats();
+    double audioSec = (double)mixed / rate;
+    std::printf("rendered %s: %.2f s of audio, %u ticks, %d flaps, score %d, %s\n", o.renderPath.c_str(), audioSec,
+        sim.tick, flaps, sim.score, sim.dead ? "died" : "tick limit");
+    std::printf("mix: %.3f ms CPU (%.0fx realtime), peak %d voices, %.2f ns per voice-frame, %.3f ms per voice-second\n",
+        st.mixTotalMs, audioSec * 1000.0 / std::max(st.mixTotalMs, 1e-9), st.voicesPeak,
+        st.voiceFrames ? st.mixTotalMs * 1e6 / st.voiceFrames : 0.0,
+        st.voiceFrames ? st.mixTotalMs * rate / st.voiceFrames : 0.0);
+
+    if (o.goldenPath.empty()) return true;
+    Sound golden;
+    if (!loadWav(o.goldenPath.c_str(), golden)) { std::fprintf(stderr, "cannot load golden %s\n", o.goldenPath.c_str()); return false; }
+    if (golden.frames != mixed || golden.rate != rate) {
+        std::printf("FAIL: golden has %d frames @ %d Hz, render has %lld @ %d Hz\n", golden.frames, golden.rate, mixed, rate);
+        return false;
+    }
+    int maxDiff = 0;
+    long long firstBad = -1;
+    for (size_t i = 0; i < pcm.size(); i++) {
+        int d = std::abs(pcm[i] - golden.pcm[i]);
+        if (d > o.goldenTolerance && firstBad < 0) firstBad = (long long)i / 2;
+        maxDiff = std::max(maxDiff, d);
+    }
+    if (firstBad >= 0) {
+        std::printf("FAIL: differs from %s, max sample diff %d, first at frame %lld (%.3f s)\n", o.goldenPath.c_str(), maxDiff, firstBad, (double)firstBad / rate);
+        return false;
+    }
+    std::printf("PASS: matches %s (max sample diff %d)\n", o.goldenPath.c_str(), maxDiff);
+    return true;
+}
+
+// Mixes looping voices (staggered so they read different parts of the sounds) through every
+// available kernel path, at the sounds' own rate and resampled to 48 kHz with varying pitch.
+// Reports CPU per second of audio and checks every path matches the scalar output exactly.
+static bool benchMix(const RunOptions& o) {
+    Sound hop, death;
+    std::string hopPath = o.soundDir + "/hop.wav", deathPath = o.soundDir + "/death.wav";
+    if (!loadWav(hopPath.c_str(), hop) || !loadWav(deathPath.c_str(), death)) {
+        std::fprintf(stderr, "cannot load %s / %s\n", hopPath.c_str(), deathPath.c_str());
+        return false;
+    }
+    const MixPath paths[] = { MixPath::Scalar, MixPath::SSE2, MixPath::AVX2, MixPath::NEON };
+    const int voiceCounts[] = { 1, 16, 64, 256 };
+    const int block = 128;
+    const double seconds = 2.0;
+    bool allMatch = true;
+
+    std::printf("%-7s %-10s %6s %12s %9s %16s\n", "path", "mode", "voices", "ms CPU/s", "% core", "voice-ms/CPU-ms");
+    for (int resample = 0; resample < 2; resample++) {
+        int rate = resample ? 48000 : 44100;
+        for (int voices : voiceCounts) {
+            std::vector<int16_t> reference;
+            for (MixPath path : paths) {
+                if (!mixPathAvailable(path)) continue;
+                AudioEngine eng;
+                int ids[2] = { eng.addSound(hop), eng.addSound(death) };
+                eng.init(AudioBackend::Manual, rate, block);
+                eng.setMixPath(path);
+
+                const int stagger = 313;
+                std::vector<int16_t> out((size_t)stagger * 2);
+                for (int v = 0; v < voices; v++) {
+                    float pitch = resample ? 0.9f + 0.2f * v / voices : 1.0f;
+                    eng.play(ids[v & 1], 0.05f, true, pitch);
+                    eng.mix(out.data(), stagger);   // start positions spread over the sounds
+                }
+
+                int blocks = (int)(seconds * rate / block);
+                std::vector<int16_t> pcm((size_t)blocks * block * 2);
+                auto t0 = Clock::now();
+                for (int b = 0; b < blocks; b++) eng.mix(&pcm[(size_t)b * block * 2], block);
+                double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+                double audioMs = blocks * block * 1000.0 / rate;
+                std::printf("%-7s %-10s %6d %12.3f %8.3f%% %16.0f\n", mixPathName(path), resample ? "resample" : "native",
+                    voices, cpuMs / (audioMs / 1000.0), 100.0 * cpuMs / audioMs, voices * audioMs / cpuMs);
+
+                if (reference.empty()) reference = pcm;
+                else if (pcm != reference) {
+                    std::printf("FAIL: %s output differs from scalar (%d voices, %s)\n", mixPathName(path), voices, resample ? "resample" : "native");
+                    allMatch = false;
+                }
+            }
+        }
+    }
+    if (allMatch) std::printf("PASS: every path is bit-identical to scalar\n");
+    return allMatch;
+}
+
+// Drives the sim and the mixer for allocFrames frames the way the game loop does at 60 fps:
+// two ticks per frame with scripted flaps, sounds triggered on events, a frame of audio mixed,
+// a restart after every death. After the first frame nothing may touch the heap.
+static bool allocCheck(const RunOptions& o) {
+    Sound hop, death;
+    std::string hopPath = o.soundDir + "/hop.wav", deathPath = o.soundDir + "/death.wav";
+    if (!loadWav(hopPath.c_str(), hop) || !loadWav(deathPath.c_str(), death)) {
+        std::fprintf(stderr, "cannot load %s / %s\n", hopPath.c_str(), deathPath.c_str());
+        return false;
+    }
+    AudioEngine eng;
+    int hopId = eng.addSound(hop), deathId = eng.addSound(death);
+    eng.init(AudioBackend::Manual);
+    const int audioFrames = eng.outputRate() / 60;
+    std::vector<int16_t> out((size_t)audioFrames * 2);
+
+    GameSim sim(o.params, mixSeed(o.seed, 0));
+    int restarts = 0;
+    long long ticks = 0;
+    AllocStats before;
+    for (int f = -1; f < o.allocFrames; f++) {
+        if (f == 0) before = allocStatsThread();
+        for (int t = 0; t < 2; t++, ticks++) {
+            InputFrame in; in.flap = scriptedFlap(sim);
+            uint32_t ev = sim.step(in);
+            if (ev & SIM_EV_FLAP) eng.play(hopId);
+            if (ev & SIM_EV_DIED) { eng.play(deathId); sim.reset(mixSeed(o.seed, ++restarts)); }
+        }
+        eng.mix(out.data(), audioFrames);
+    }
+    AllocStats after = allocStatsThread();
+    uint64_t n = after.count - before.count;
+    std::printf("alloc check: %d frames, %lld ticks, %d restarts, %llu allocations (%llu bytes) -> %s\n", o.allocFrames, ticks,
+        restarts, (unsigned long long)n, (unsigned long long)(after.bytes - before.bytes), n == 0 ? "PASS" : "FAIL");
+    return n == 0;
+}
+
+// The pipe queue as it was before PipeRing: a vector trimmed with erase(begin()) per expired
+// pipe, separate scroll / score / collide loops. Only the --bench-pipes baseline; the bird
+// sits at y 0 without flapping, as in the benchmark's GameSim.
+struct VectorPipeSim {
+    GameParams P;
+    std::vector<Pipe> pipes;
+    float timeSinceSpawn = 0.0f;
+    Pcg32 rng;
+    int score = 0;
+    bool hit = false;
+
+    VectorPipeSim(const GameParams& p, uint32_t seed) : P(p), rng(seed, COURSE_STREAM) {}
+
+    void step() {
+        const float dt = P.fixedDt, birdY = 0.0f;
+        timeSinceSpawn += dt;
+        if (timeSinceSpawn > P.spawnInterval) {
+            timeSinceSpawn = 0.0f;
+            Pipe p;
+            p.x = 1.2f; p.width = P.pipeWidth; p.gapSize = P.pipeGapSize;
+            p.gapY = spawnGapY(P, rng.unit());
+            pipes.push_back(p);
+        }
+        for (auto& p : pipes) p.x -= P.pipeSpeed * dt;
+        for (auto& p : pipes) {
+            if (!p.scored && p.x + p.width * 0.5f < P.birdX) { p.scored = true; score++; }
+        }
+        while (!pipes.empty() && pipes.front().x + pipes.front().width < -1.5f) pipes.erase(pipes.begin());
+        for (auto& p : pipes) {
+            bool overlapsX = !(P.birdX + P.birdRadius < p.x - p.width * 0.5f || P.birdX - P.birdRadius > p.x + p.width * 0.5f);
+            bool insideGap = (birdY + P.birdRadius < p.gapY + p.gapSize * 0.5f) && (birdY - P.birdRadius > p.gapY - p.gapSize * 0.5f);
+            if (overlapsX && !insideGap && !P.godMode) { hit = true; break; }
+        }
+    }
+};
+
+// GameSim (PipeRing) against the old vector queue at rising pipe densities, godMode so nothing
+// ends the run. Both fill the screen first, then the same number of ticks is timed; the
+// scores and live pipe counts must match. "ring ns" is the whole GameSim::step per tick.
+static bool benchPipes(const RunOptions& o) {
+    struct Density { float speed, spawn; };
+    const Density densities[] = { { 0.3f, 1.6f }, { 0.3f, 0.16f }, { 0.3f, 0.016f }, { 0.3f, 0.001f }, { 0.03f, 0.001f }, { 0.0075f, 0.001f } };
+    const int timedTicks = 20000;
+    bool allMatch = true;
+
+    std::printf("%8s %8s %12s %12s %9s %12s\n", "speed", "spawn", "live pipes", "vector ns", "ring ns", "ring ns/pipe");
+    for (const Density& d : densities) {
+        GameParams P = o.params;
+        P.pipeSpeed = d.speed; P.spawnInterval = d.spawn; P.pipeWidth = 0.004f; P.godMode = true;
+        int fillTicks = (int)((2.7f + P.pipeWidth) / (P.pipeSpeed * P.fixedDt)) + 10;
+
+        GameSim sim(P, o.seed);
+        VectorPipeSim ref(P, o.seed);
+        InputFrame none;
+        for (int t = 0; t < fillTicks; t++) { sim.step(none); ref.step(); }
+
+        auto t0 = Clock::now();
+        for (int t = 0; t < timedTicks; t++) ref.step();
+        double refNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / timedTicks;
+        t0 = Clock::now();
+        for (int t = 0; t < timedTicks; t++) sim.step(none);
+        double ringNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / timedTicks;
+
+        std::printf("%8.4f %8.3f %12d %12.1f %9.1f %12.2f   x%.1f\n", d.speed, d.spawn, sim.pipes.size(), refNs, ringNs,
+            ringNs / std::max(1, sim.pipes.size()), refNs / ringNs);
+        if (sim.score != ref.score || sim.pipes.size() != (int)ref.pipes.size()) {
+            std::printf("FAIL: ring and vector disagree (score %d vs %d, pipes %d vs %zu)\n", sim.score, ref.score, sim.pipes.size(), ref.pipes.size());
+            allMatch = false;
+        }
+    }
+    return allMatch;
+}
+
+// Every pipe tested against the bird, the way collision worked before the broadphase.
+static bool bruteHitsPipe(const GameSim& sim) {
+    const float invScroll = sim.prevScroll > 0.0f ? 1.0f / sim.prevScroll : 0.0f;
+    bool hit = false;
+    for (int i = 0; i < sim.pipes.size(); i++) hit |= pipeSweptHit(sim.params, sim.pipes[i], sim.prevBirdY, sim.birdY, sim.prevScroll, invScroll);
+    return hit;
+}
+
+// Collision cost against live pipe count: thin pipes, godMode, the scripted bird flapping
+// through them. Each tick the broadphase (GameSim::hitsPipe) and the brute-force scan are
+// timed on the same world and must agree; "step ns" is the whole tick, which still scrolls
+// every pipe. Each timing includes a clock read (~20-30 ns here).
+static bool benchBroadphase(const RunOptions& o) {
+    struct Density { float speed, spawn; };   // one spawn per tick at most, so slow pipes pack tighter
+    const Density densities[] = { { 0.3f, 1.6f }, { 0.3f, 0.16f }, { 0.3f, 0.001f }, { 0.03f, 0.001f }, { 0.0075f, 0.001f } };
+    const int timedTicks = 5000;
+    bool allMatch = true;
+
+    std::printf("%12s %12s %14s %10s %10s\n", "live pipes", "brute ns", "broadphase ns", "step ns", "mismatch");
+    for (const Density& d : densities) {
+        GameParams P = o.params;
+        P.pipeSpeed = d.speed; P.spawnInterval = d.spawn; P.pipeWidth = 0.004f; P.godMode = true;
+        int fillTicks = (int)((2.7f + P.pipeWidth) / (P.pipeSpeed * P.fixedDt)) + 10;
+
+        GameSim sim(P, o.seed);
+        for (int t = 0; t < fillTicks; t++) { InputFrame in; in.flap = scriptedFlap(sim); sim.step(in); }
+
+        double bruteNs = 0.0, broadNs = 0.0, stepNs = 0.0;
+        int mismatches = 0;
+        for (int t = 0; t < timedTicks; t++) {
+            InputFrame in; in.flap = scriptedFlap(sim);
+            auto t0 = Clock::now();
+            sim.step(in);
+            auto t1 = Clock::now();
+            bool fast = sim.hitsPipe();
+            auto t2 = Clock::now();
+            bool brute = bruteHitsPipe(sim);
+            auto t3 = Clock::now();
+            stepNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            broadNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+            bruteNs += std::chrono::duration<double, std::nano>(t3 - t2).count();
+            if (fast != brute) mismatches++;
+        }
+        std::printf("%12d %12.1f %14.1f %10.1f %10d\n", sim.pipes.size(), bruteNs / timedTicks, broadNs / timedTicks,
+            stepNs / timedTicks, mismatches);
+        if (mismatches) allMatch = false;
+    }
+    std::printf(allMatch ? "PASS: broadphase agrees with the full scan on every tick\n" : "FAIL: broadphase and full scan disagree\n");
+    return allMatch;
+}
+
+// Fine-step reference for pipeSweptHit / pipeMaskHit: the plain end-position test at
+// `steps`+1 points along the same straight path (bird y0 -> y1, pipe from x + scroll back to
+// x), with the hitbox grown by (growX, growY): the square's half size, or for a mask the pipe
+// widened and the gap narrowed by as much.
+static bool sampledHit(const GameParams& P, const Pipe& p, float y0, float y1, float scroll, int steps, float growX, float growY) {
+    for (int k = 0; k <= steps; k++) {
+        float s = (float)k / steps;
+        float y = y0 + (y1 - y0) * s;
+        float x = p.x + scroll * (1.0f - s);
+        float pl = x - p.width * 0.5f - growX, pr = x + p.width * 0.5f + growX;
+        float gb = p.gapY - p.gapSize * 0.5f + growY, gt = p.gapY + p.gapSize * 0.5f - growY;
+        if (P.birdMask) {
+            if (P.birdMask->hitsPipe(P.birdX, y, pl, pr, gb, gt)) return true;
+            continue;
+        }
+        bool overlapsX = !(P.birdX + P.birdRadius < pl || P.birdX - P.birdRadius > pr);
+        bool insideGap = (y + P.birdRadius < gt) && (y - P.birdRadius > gb);
+        if (overlapsX && !insideGap) return true;
+    }
+    return false;
+}
+
+static bool fuzzCcd(const RunOptions& o) {
+    const int refSteps = 256, ticksPerWorld = 600;
+    long long ticks = 0, hits = 0, endMissed = 0, tunnels = 0, falseHits = 0, broadMismatch = 0;
+
+    for (int w = 0; w < o.fuzzWorlds; w++) {
+        Pcg32 rng(o.seed, (uint64_t)w);   // a stream per world
+        auto uniform = [&](float lo, float hi) { return lo + (hi - lo) * rng.unit(); };
+        GameParams P = o.params;
+        P.fixedDt = uniform(1.0f / 240.0f, 0.05f);
+        P.pipeSpeed = uniform(0.1f, 1.5f);
+        P.pipeWidth = uniform(0.002f, 0.12f);
+        P.pipeGapSize = uniform(0.1f, 0.6f);
+        P.spawnInterval = uniform(0.1f, 1.6f);
+        P.godMode = true;
+        float flapChance = uniform(0.02f, 0.3f);
+
+        GameSim sim(P, rng.next());
+        for (int t = 0; t < ticksPerWorld; t++) {
+            InputFrame in;
+            in.flap = rng.unit() < flapChance;
+            sim.step(in);
+            ticks++;
+
+            const float scroll = sim.prevScroll, invScroll = scroll > 0.0f ? 1.0f / scroll : 0.0f;
+            const CollisionMask* m = P.birdMask;
+            const float growX = scroll / refSteps + (m ? 1.0f / m->invCellW : 0.0f) + 1e-5f;
+            const float growY = std::fabs(sim.birdY - sim.prevBirdY) / refSteps + (m ? 1.0f / m->invCellH : 0.0f) + 1e-5f;
+            bool anySwept = false;
+            for (int i = 0; i < sim.pipes.size(); i++) {
+                const Pipe& p = sim.pipes[i];
+                bool swept = m ? pipeMaskHit(P, p, sim.prevBirdY, sim.birdY, scroll, invScroll) : pipeSweptHit(P, p, sim.prevBirdY, sim.birdY, scroll, invScroll);
+                bool ref = sampledHit(P, p, sim.prevBirdY, sim.birdY, scroll, refSteps, 0.0f, 0.0f);
+                anySwept |= swept;
+                if (swept) {
+                    hits++;
+                    if (!sampledHit(P, p, sim.birdY, sim.birdY, 0.0f, 1, 0.0f, 0.0f)) endMissed++;
+                }
+                if (ref && !swept) {
+                    if (tunnels++ < 5) std::printf("  tunnel: world %d tick %d pipe x %.6f y %.6f -> %.6f\n", w, t, p.x, sim.prevBirdY, sim.birdY);
+                }
+                if (swept && !sampledHit(P, p, sim.prevBirdY, sim.birdY, scroll, refSteps, growX, growY)) {
+                    if (falseHits++ < 5) std::printf("  false hit: world %d tick %d pipe x %.6f y %.6f -> %.6f\n", w, t, p.x, sim.prevBirdY, sim.birdY);
+                }
+            }
+            if (sim.hitsPipe() != anySwept) broadMismatch++;
+        }
+    }
+
+    std::printf("%d worlds, %lld ticks: %lld pipe hits, %lld of them missed by the end-position test\n",
+        o.fuzzWorlds, ticks, hits, endMissed);
+    std::printf("tunnelled %lld, false hits %lld, broadphase mismatches %lld\n", tunnels, falseHits, broadMismatch);
+    bool ok = tunnels == 0 && falseHits == 0 && broadMismatch == 0;
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok;
+}
+
+// The same hitbox flappy builds from the bunny frames: the union of the PNGs' alpha masks over
+// the sprite's 90x90 px frame.
+static bool loadMask(const std::vector<std::string>& paths, CollisionMask& m) {
+    m = CollisionMask();
+    m.halfW = BUNNY_HALF_W;
+    m.halfH = BUNNY_HALF_H;
+    stbi_set_flip_vertically_on_load(1);   // rows bottom-up, like the game's loader
+    for (const std::string& path : paths) {
+        int w = 0, h = 0, channels = 0;
+        unsigned char* d = stbi_load(path.c_str(), &w, &h, &channels, 4);
+        if (!d) { std::fprintf(stderr, "Failed load: %s\n", path.c_str()); return false; }
+        m.addSprite(d, w, 0, 0, w, h, 0.0f, 0.0f, 1.0f, 1.0f);
+        stbi_image_free(d);
+    }
+    m.finish();
+    if (m.empty()) { std::fprintf(stderr, "mask is empty (no opaque pixels)\n"); return false; }
+    std::printf("mask: %d of %d cells solid, reach left %.4f right %.4f up %.4f down %.4f\n",
+        m.solidCells, CollisionMask::SIZE * CollisionMask::SIZE, m.extLeft, m.extRight, m.extTop, m.extBottom);
+    return true;
+}
+
+// Collision cost of the square against the --mask hitbox: the same godMode run (scripted
+// flaps) with each, timing every tick's step and REPEAT extra hitsPipe() calls on its world.
+static bool benchMask(const RunOptions& o) {
+    if (!o.params.birdMask) { std::fprintf(stderr, "--bench-mask needs --mask\n"); return false; }
+    const int ticks = 200000, REPEAT = 8;
+    std::printf("%8s %12s %12s %10s\n", "hitbox", "step ns", "collide ns", "hits");
+    for (int pass = 0; pass < 2; pass++) {
+        GameParams P = o.params;
+        P.godMode = true;
+        if (pass == 0) P.birdMask = nullptr;
+        GameSim sim(P, o.seed);
+        double stepNs = 0.0, hitNs = 0.0;
+        long long hits = 0;
+        for (int t = 0; t < ticks; t++) {
+            InputFrame in; in.flap = scriptedFlap(sim);
+            auto t0 = Clock::now();
+            sim.step(in);
+            auto t1 = Clock::now();
+            int n = 0;
+            for (int r = 0; r < REPEAT; r++) n += sim.hitsPipe();
+            auto t2 = Clock::now();
+            stepNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            hitNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+            hits += n / REPEAT;
+        }
+        std::printf("%8s %12.1f %12.1f %10lld\n", pass == 0 ? "square" : "mask", stepNs / ticks, hitNs / ticks / REPEAT, hits);
+    }
+    return true;
+}
+
+// --course N: the first N pipes of the course for --seed and the gap params. Generated in one
+// go, then again in chunks on the pool, each chunk jumping straight to its first pipe; the two
+// must match bit for bit, and so must the pipes a GameSim run actually spawns. The hash lets
+// two machines (or players) compare courses.
+static bool courseCheck(const RunOptions& o, WorkPool& pool) {
+    const long long n = o.coursePipes;
+    std::vector<float> whole((size_t)n), chunked((size_t)n);
+
+    auto t0 = Clock::now();
+    generateCourse(o.params, o.seed, 0, (int)n, whole.data());
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    t0 = Clock::now();
+    pool.parallelFor(n, 1 << 16, [&](long long b, long long e, int) {
+        generateCourse(o.params, o.seed, (uint64_t)b, (int)(e - b), chunked.data() + b);
+    });
+    double chunkSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    bool ok = std::memcmp(whole.data(), chunked.data(), whole.size() * sizeof(float)) == 0;
+    if (!ok) std::printf("FAIL: chunked course differs from the one-go course\n");
+
+    // what GameSim spawns (a spawn resets timeSinceSpawn to exactly 0)
+    GameParams P = o.params;
+    P.godMode = true;
+    GameSim sim(P, o.seed);
+    long long spawned = 0, checkPipes = std::min<long long>(n, 500);
+    InputFrame none;
+    while (ok && spawned < checkPipes) {
+        sim.step(none);
+        if (sim.timeSinceSpawn != 0.0f) continue;
+        if (!sameBits(sim.pipes[sim.pipes.size() - 1].gapY, whole[(size_t)spawned])) {
+            std::printf("FAIL: pipe %lld spawned by GameSim differs from the course\n", spawned);
+            ok = false;
+        }
+        spawned++;
+    }
+
+    uint64_t hash = 0xCBF29CE484222325ull;   // FNV-1a over the gap values' bits
+    for (float g : whole) {
+        uint32_t bits;
+        std::memcpy(&bits, &g, sizeof(bits));
+        for (int k = 0; k < 4; k++) { hash ^= (bits >> (8 * k)) & 0xFF; hash *= 0x100000001B3ull; }
+    }
+    std::printf("course seed %u, %lld pipes: hash %016llx\n", o.seed, n, (unsigned long long)hash);
+    std::printf("  one go %.1f M pipes/s, %d workers in chunks %.1f M pipes/s, %lld checked against GameSim\n",
+        n / seconds / 1e6, pool.size(), n / chunkSeconds / 1e6, spawned);
+    if (ok) std::printf("PASS\n");
+    return ok;
+}
+
+// --write-replay: one run of the policy on course --seed (as flappy seeds it, no mixSeed),
+// recorded the way flappy records, so headless can make replays for the checks below.
+static bool writeReplay(const RunOptions& o) {
+    GameSim sim(o.params, o.seed);
+    Replay r;
+    r.begin(o.params, o.seed);
+    uint32_t policyRng = (o.seed ^ 0xA5A5A5A5u) ? (o.seed ^ 0xA5A5A5A5u) : 1;
+    while (!sim.dead && sim.tick < o.maxTicks) {
+        InputFrame in;
+        in.flap = o.policy == Policy::Scripted ? scriptedFlap(sim) : randomFlap(policyRng, o.flapChance);
+        r.record(sim, in);
+        sim.step(in);
+    }
+    r.finish(sim);
+    if (!saveReplay(o.replayOut.c_str(), r)) return false;
+    FILE* f = std::fopen(o.replayOut.c_str(), "rb");
+    long bytes = 0;
+    if (f) { std::fseek(f, 0, SEEK_END); bytes = std::ftell(f); std::fclose(f); }
+    std::printf("wrote %s: seed %u, %u ticks, %zu flaps, score %d, %s%s, %ld bytes\n", o.replayOut.c_str(), r.seed, r.endTick,
+        r.flaps.size(), r.score, r.died ? "died" : "tick limit", r.hasMask ? ", pixel hitbox" : "", bytes);
+    return true;
+}
+
+// --verify-replay: plays each file back with no input but its own and checks tick count, score
+// and final world hash against the recording. Then replays it again for at least 0.2 s to
+// report playback speed against real time.
+static bool verifyReplays(const RunOptions& o) {
+    bool allOk = true;
+    for (const std::string& path : o.replayPaths) {
+        Replay r;
+        if (!loadReplay(path.c_str(), r)) { allOk = false; continue; }
+        if (r.buildHash != replayBuildHash()) {
+            std::printf("%s: recorded by another build (%016llx, this is %016llx), playback may differ\n", path.c_str(),
+                (unsigned long long)r.buildHash, (unsigned long long)replayBuildHash());
+        }
+        GameSim sim(r.gameParams(), r.seed);
+        ReplayResult res = playReplay(r, sim);
+
+        long long runs = 0;
+        double seconds = 0.0;
+        auto t0 = Clock::now();
+        do {
+            playReplay(r, sim);
+            runs++;
+            seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        } while (seconds < 0.2);
+        double played = (double)r.endTick * r.params.fixedDt * runs;
+
+        std::printf("%s: seed %u, %u ticks, %zu flaps -> score %d (recorded %d), %s at tick %u (recorded %s at %u), hash %016llx %s\n",
+            path.c_str(), r.seed, r.endTick, r.flaps.size(), res.score, r.score, res.died ? "died" : "alive", res.ticks,
+            r.died ? "died" : "alive", r.endTick, (unsigned long long)res.stateHash, res.stateHash == r.stateHash ? "ok" : "DIFFERS");
+        std::printf("  %.3f ms per playback, %.0fx real time -> %s\n", seconds * 1000.0 / runs, played / seconds,
+            res.matches ? "PASS" : "FAIL");
+        allOk = allOk && res.matches;
+    }
+    return allOk;
+}
+
+// --bench-replay: flap streams from long godMode runs (scripted, and random at --flap-chance)
+// through the varint coder, then through ReplayWriter as the game would feed it, timing
+// record() on the calling thread; the file must load back to the same flaps.
+static bool benchReplay(const RunOptions& o) {
+    const uint32_t ticks = 120u * 3600u * 10u;   // ten hours of play
+    bool ok = true;
+    std::printf("%8s %10s %10s %11s %12s %12s %12s\n", "policy", "flaps", "bytes", "bytes/flap", "encode MB/s", "decode MB/s", "M flaps/s");
+    for (int pass = 0; pass < 2; pass++) {
+        GameParams P = o.params;
+        P.godMode = true;
+        GameSim sim(P, o.seed);
+        uint32_t policyRng = (o.seed ^ 0xA5A5A5A5u) ? (o.seed ^ 0xA5A5A5A5u) : 1;
+        std::vector<uint32_t> flaps;
+        for (uint32_t t = 0; t < ticks; t++) {
+            InputFrame in;
+            in.flap = pass == 0 ? scriptedFlap(sim) : randomFlap(policyRng, o.flapChance);
+            if (in.flap) flaps.push_back(sim.tick);
+            sim.step(in);
+        }
+
+        std::vector<uint8_t> bytes(flaps.size() * REPLAY_MAX_VARINT);
+        std::vector<uint32_t> back(flaps.size());
+        const int REPEAT = 20;
+        size_t size = 0;
+        auto t0 = Clock::now();
+        for (int r = 0; r < REPEAT; r++) size = encodeFlaps(flaps.data(), flaps.size(), bytes.data());
+        double encSec = std::chrono::duration<double>(Clock::now() - t0).count() / REPEAT;
+        bool decoded = true;
+        t0 = Clock::now();
+        for (int r = 0; r < REPEAT; r++) decoded = decodeFlaps(bytes.data(), size, back.data(), back.size()) && decoded;
+        double decSec = std::chrono::duration<double>(Clock::now() - t0).count() / REPEAT;
+        if (!decoded || back != flaps) { std::printf("FAIL: decoded flaps differ\n"); ok = false; }
+
+        // MB/s of the encoded stream; bytes/flap against 4 for plain uint32 ticks
+        std::printf("%8s %10zu %10zu %11.3f %12.0f %12.0f %12.0f\n", pass == 0 ? "scripted" : "random", flaps.size(), size,
+            (double)size / std::max<size_t>(flaps.size(), 1), size / encSec / 1e6, size / decSec / 1e6, flaps.size() / decSec / 1e6);
+
+        // the same run through the streaming writer, one record() per tick like the frame loop
+        ReplayWriter writer;
+        GameSim fake(P, o.seed);
+        writer.begin(o.replayOut.c_str(), P, o.seed);
+        size_t next = 0;
+        double worstNs = 0.0, floorNs = 0.0;   // floor: the worst of an empty timed region, i.e. preemption
+        t0 = Clock::now();
+        for (uint32_t t = 0; t < ticks; t++) {
+            fake.tick = t;
+            InputFrame in;
+            in.flap = next < flaps.size() && flaps[next] == t;
+            if (in.flap) next++;
+            auto r0 = Clock::now();
+            writer.record(fake, in);
+            auto r1 = Clock::now();
+            worstNs = std::max(worstNs, std::chrono::duration<double, std::nano>(r1 - r0).count());
+            floorNs = std::max(floorNs, std::chrono::duration<double, std::nano>(Clock::now() - r1).count());
+        }
+        double recSec = std::chrono::duration<double>(Clock::now() - t0).count();
+        writer.finish(fake);
+        t0 = Clock::now();
+        ReplayWriter::Report rep = writer.flush();
+        double flushMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        Replay r;
+        if (!rep.ok || rep.saved != 1 || !loadReplay(o.replayOut.c_str(), r) || r.flaps != flaps) { std::printf("FAIL: streamed replay differs\n"); ok = false; }
+        std::printf("%8s writer: %llu bytes, record() %.1f ns per tick (incl. timer), worst %.0f ns (timer alone %.0f ns), final flush %.2f ms, %u chunks dropped\n", "",
+            (unsigned long long)writer.bytesWritten(), recSec * 1e9 / ticks, worstNs, floorNs, flushMs, rep.droppedChunks);
+    }
+    std::remove(o.replayOut.c_str());
+    if (ok) std::printf("PASS\n");
+    return ok;
+}
+
+static void printUsage() {
+    std::printf(
+        "usage: headless [options]\n"
+        "  --batch           step SIM_BATCH_LANES worlds at once with the best SIMD path\n"
+        "  --verify-batch    check scalar/SSE2/AVX2 batch paths and GameSim agree bit for bit\n"
+        "  --threads N       worker threads, 0 = all cores (default 1)\n"
+        "  --scaling         run the episode set at 1, 2, 4, ... threads and report efficiency\n"
+        "  --episodes N      number of episodes (default 10000)\n"
+        "  --max-ticks N     tick limit per episode (default 72000)\n"
+        "  --seed N          base seed (default 1)\n"
+        "  --policy P        scripted | random (default scripted)\n"
+        "  --flap-chance F   random policy flap probability per tick (default 0.04)\n"
+        "  --gravity F  --flap F  --speed F  --spawn F  --gap F  --width F  --dt F\n"
+        "  --render-audio F  play one episode (--seed, --policy) and mix its sounds into WAV file F\n"
+        "  --inputs F        render: flap on the ticks listed in F instead of using the policy\n"
+        "  --save-inputs F   render: write the flap ticks that were used to F\n"
+        "  --golden F        render: compare against WAV file F, fail on any difference\n"
+        "  --golden-tolerance N  render: accept per-sample differences up to N\n"
+        "  --sounds DIR      render: where hop.wav and death.wav are (default sounds)\n"
+        "  --bench-mix       time the mixer kernels (scalar/SSE2/AVX2/NEON) at 1..256 voices\n"
+        "  --alloc-check N   run N game frames of sim + mixer and fail on any heap allocation\n"
+        "  --bench-pipes     time the pipe queue (ring vs the old vector) at rising pipe densities\n"
+        "  --bench-broadphase  collision cost (broadphase vs testing every pipe) at rising pipe counts\n"
+        "  --fuzz-ccd N      check swept collision against a fine-step reference in N random worlds\n"
+        "  --mask F          pixel hitbox from PNG F's alpha (repeat for the union of several frames)\n"
+        "  --bench-mask      collision cost of the --mask hitbox against the square\n"
+        "  --course N        generate the first N pipes of the --seed course (one go and chunked), print its hash\n"
+        "  --write-replay F  record one run of the policy on course --seed into replay file F\n"
+        "  --verify-replay F play replay F back, check it ends exactly as recorded (repeatable)\n"
+        "  --bench-replay    replay flap stream encode/decode MB/s and streaming writer cost\n");
+}
+
+static bool parseArgs(int argc, char** argv, RunOptions& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        auto takesValue = [&](const char* name) { return std::strcmp(a, name) == 0 && v && ++i; };
+
+        if (std::strcmp(a, "--batch") == 0) o.batch = true;
+        else if (std::strcmp(a, "--scaling") == 0) o.mode = Mode::Scaling;
+        else if (takesValue("--threads")) o.threads = std::atoi(v);
+        else if (std::strcmp(a, "--verify-batch") == 0) o.mode = Mode::VerifyBatch;
+        else if (takesValue("--episodes")) o.episodes = std::atoll(v);
+        else if (takesValue("--max-ticks")) o.maxTicks = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (takesValue("--seed")) o.seed = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (takesValue("--policy")) {
+            if (std::strcmp(v, "scripted") == 0) o.policy = Policy::Scripted;
+            else if (std::strcmp(v, "random") == 0) o.policy = Policy::Random;
+            else { std::fprintf(stderr, "Unknown policy: %s\n", v); return false; }
+        }
+        else if (takesValue("--flap-chance")) o.flapChance = (float)std::atof(v);
+        else if (takesValue("--gravity")) o.params.gravity = (float)std::atof(v);
+        else if (takesValue("--flap")) o.params.flapStrength = (float)std::atof(v);
+        else if (takesValue("--speed")) o.params.pipeSpeed = (float)std::atof(v);
+        else if (takesValue("--spawn")) o.params.spawnInterval = (float)std::atof(v);
+        else if (takesValue("--gap")) o.params.pipeGapSize = (float)std::atof(v);
+        else if (takesValue("--width")) o.params.pipeWidth = (float)std::atof(v);
+        else if (takesValue("--dt")) o.params.fixedDt = (float)std::atof(v);
+        else if (takesValue("--render-audio")) { o.mode = Mode::RenderAudio; o.renderPath = v; }
+        else if (takesValue("--inputs")) o.inputsPath = v;
+        else if (takesValue("--save-inputs")) o.saveInputsPath = v;
+        else if (takesValue("--golden")) o.goldenPath = v;
+        else if (takesValue("--golden-tolerance")) o.goldenTolerance = std::atoi(v);
+        else if (takesValue("--sounds")) o.soundDir = v;
+        else if (std::strcmp(a, "--bench-mix") == 0) o.mode = Mode::BenchMix;
+        else if (std::strcmp(a, "--bench-pipes") == 0) o.mode = Mode::BenchPipes;
+        else if (std::strcmp(a, "--bench-broadphase") == 0) o.mode = Mode::BenchBroadphase;
+        else if (takesValue("--course")) { o.mode = Mode::Course; o.coursePipes = std::atoll(v); }
+        else if (takesValue("--mask")) o.maskPaths.push_back(v);
+        else if (takesValue("--write-replay")) { o.mode = Mode::WriteReplay; o.replayOut = v; }
+        else if (takesValue("--verify-replay")) { o.mode = Mode::VerifyReplay; o.replayPaths.push_back(v); }
+        else if (std::strcmp(a, "--bench-replay") == 0) o.mode = Mode::BenchReplay;
+        else if (std::strcmp(a, "--bench-mask") == 0) o.mode = Mode::BenchMask;
+        else if (takesValue("--fuzz-ccd")) { o.mode = Mode::FuzzCcd; o.fuzzWorlds = std::atoi(v); }
+        else if (takesValue("--alloc-check")) { o.mode = Mode::AllocCheck; o.allocFrames = std::atoi(v); }
+        else { printUsage(); return false; }
+    }
+    return o.episodes > 0 && o.params.fixedDt > 0.0f;
+}
+
+static void printReport(const RunOptions& o, std::vector<EpisodeResult>& results, double seconds) {
+    unsigned long long steps = 0;
+    long long scoreSum = 0;
+    for (const EpisodeResult& r : results) { steps += r.ticks; scoreSum += r.score; }
+
+    std::sort(results.begin(), results.end(), [](const EpisodeResult& a, const EpisodeResult& b) { return a.score < b.score; });
+    auto pct = [&](double q) { return results[(size_t)(q * (results.size() - 1))].score; };
+    size_t n = results.size();
+
+    std::printf("policy=%s episodes=%zu seed=%u threads=%d mode=%s\n", o.policy == Policy::Scripted ? "scripted" : "random", n, o.seed, o.threads,
+        o.batch ? simBatchPathName(simBatchBestPath()) : "single");
+    std::printf("params: gravity=%.3f flap=%.3f speed=%.3f spawn=%.3f gap=%.3f width=%.3f dt=%.5f\n",
+        o.params.gravity, o.params.flapStrength, o.params.pipeSpeed, o.params.spawnInterval,
+        o.params.pipeGapSize, o.params.pipeWidth, o.params.fixedDt);
+    std::printf("time %.3f s  |  %.0f episodes/s (%.2fM/min)  |  %.2fM steps/s\n",
+        seconds, n / seconds, n / seconds * 60.0 / 1e6, steps / seconds / 1e6);
+    std::printf("score: mean %.2f  min %d  p50 %d  p90 %d  p99 %d  max %d\n",
+        (double)scoreSum / n, results.front().score, pct(0.50), pct(0.90), pct(0.99), results.back().score);
+
+    // histogram with ~10 buckets over the observed range
+    int lo = results.front().score, hi = results.back().score;
+    int bucket = std::max(1, (hi - lo + 10) / 10);
+    size_t i = 0;
+    for (int b = lo; b <= hi; b += bucket) {
+        size_t count = 0;
+        while (i < n && results[i].score < b + bucket) { count++; i++; }
+        int bar = (int)(50.0 * count / n + 0.5);
+        std::printf("  %5d-%-5d %9zu %s\n", b, b + bucket - 1, count, std::string(bar, '#').c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    RunOptions o;
+    if (!parseArgs(argc, argv, o)) return 1;
+    if (!o.maskPaths.empty()) {
+        if (!loadMask(o.maskPaths, o.mask)) return 1;
+        o.params.birdMask = &o.mask;
+    }
+    if ((o.batch || o.mode == Mode::VerifyBatch) && o.params.birdMask) {
+        std::fprintf(stderr, "the batch paths only have the square hitbox, drop --mask\n");
+        return 1;
+    }
+
+    if (o.mode == Mode::VerifyBatch) return verifyBatch(o) ? 0 : 1;
+    if (o.mode == Mode::RenderAudio) return renderAudio(o) ? 0 : 1;
+    if (o.mode == Mode::BenchMix) return benchMix(o) ? 0 : 1;
+    if (o.mode == Mode::AllocCheck) return allocCheck(o) ? 0 : 1;
+    if (o.mode == Mode::BenchPipes) return benchPipes(o) ? 0 : 1;
+    if (o.mode == Mode::BenchBroadphase) return benchBroadphase(o) ? 0 : 1;
+    if (o.mode == Mode::FuzzCcd) return fuzzCcd(o) ? 0 : 1;
+    if (o.mode == Mode::BenchMask) return benchMask(o) ? 0 : 1;
+    if (o.mode == Mode::WriteReplay) return writeReplay(o) ? 0 : 1;
+    if (o.mode == Mode::VerifyReplay) return verifyReplays(o) ? 0 : 1;
+    if (o.mode == Mode::BenchReplay) return benchReplay(o) ? 0 : 1;
+    if (o.mode == Mode::Course) { WorkPool pool(o.threads); return o.coursePipes > 0 && courseCheck(o, pool) ? 0 : 1; }
+    if (o.batch && simBatchRequiredPipeSlots(o.params) > SIM_BATCH_MAX_PIPES) {
+        std::fprintf(stderr, "params need %d pipe slots per world, batch has %d\n",
+            simBatchRequiredPipeSlots(o.params), SIM_BATCH_MAX_PIPES);
+        return 1;
+    }
+    if (o.mode == Mode::Scaling) { runScaling(o); return 0; }
+
+    std::vector<EpisodeResult> results((size_t)o.episodes);
+    WorkPool pool(o.threads);
+
+    auto t0 = Clock::now();
+    runEpisodes(o, pool, results);
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    printReport(o, results, seconds);
+    return 0;
+}
@@ -0,0 +1,89 @@
+// latency_meter.cpp
+// Hop Hop Bunny - input-to-photon latency
+
+#include "latency_meter.h"
+#include "profiler.h"
+
+#include <cstdio>
+
+void LatencyMeter::flapApplied(int64_t inputNs) {
+    if (!measuring || frameInputNs || !inputNs) return;
+    frameInputNs = inputNs;
+    frameSimNs = profNowNs();
+}
+
+void LatencyMeter::framePresented() {
+    if (!measuring && !drainGpu) return;
+    int64_t swapNs = profNowNs();
+
+    if (measuring && frameInputNs) {
+        toSim.add((frameSimNs - frameInputNs) * 1e-6);
+        toSwap.add((swapNs - frameInputNs) * 1e-6);
+        if (pendingCount == PENDING) {   // the GPU is that far behind; give up on the oldest
+            glDeleteSync(pending[pendingHead].fence);
+            pendingHead = (pendingHead + 1) % PENDING;
+            pendingCount--;
+        }
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (fence) {
+            glFlush();   // so the fence reaches the GPU without anyone waiting on it
+            pending[(pendingHead + pendingCount) % PENDING] = { fence, frameInputNs, swapNs };
+            pendingCount++;
+        }
+        frameInputNs = 0;
+    }
+    if (drainGpu) glFinish();
+    pollFences();
+}
+
+void LatencyMeter::pollFences() {
+    int64_t nowNs = profNowNs();
+    while (pendingCount) {
+        Pending& p = pending[pendingHead];
+        GLenum r = glClientWaitSync(p.fence, 0, 0);
+        bool signalled = r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED;
+        if (!signalled && r != GL_WAIT_FAILED && nowNs - p.swapNs < 100000000) break;   // 100 ms
+        if (signalled) toGpu.add((nowNs - p.inputNs) * 1e-6);
+        glDeleteSync(p.fence);
+        pendingHead = (pendingHead + 1) % PENDING;
+        pendingCount--;
+    }
+}
+
+void LatencyMeter::printReport(const char* modeLabel, bool rows) const {
+    if (!measuring) return;
+    if (!toSwap.count) { printf("Latency (%s): no flaps measured\n", modeLabel); return; }
+    char title[128];
+    snprintf(title, sizeof(title), "Latency %s, input -> sim", modeLabel);
+    toSim.print(title, 0.0, false);
+    snprintf(title, sizeof(title), "Latency %s, input -> swap", modeLabel);
+    toSwap.print(title, 0.0, rows);
+    snprintf(title, sizeof(title), "Latency %s, input -> gpu done", modeLabel);
+    toGpu.print(title, 0.0, rows);
+}
+
+bool LatencyMeter::writeCsv(const char* path, const char* modeLabel) const {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "cannot write %s\n", path); return false; }
+    const PacingHistogram* stages[3] = { &toSim, &toSwap, &toGpu };
+    const char* names[3] = { "sim", "swap", "gpu" };
+    fprintf(f, "# input-to-photon latency, %s, %llu flaps\n", modeLabel, (unsigned long long)toSwap.count);
+    for (int s = 0; s < 3; s++) {
+        const PacingHistogram& h = *stages[s];
+        fprintf(f, "# %s: mean %.3f p50 %.3f p99 %.3f max %.3f ms\n", names[s], h.meanMs(), h.percentileMs(0.5),
+            h.percentileMs(0.99), h.maxMs);
+    }
+    fprintf(f, "# the last bin also counts everything longer\n");
+    fprintf(f, "bin_start_ms,bin_end_ms,sim,swap,gpu\n");
+    int last = 0;
+    for (int b = 0; b < PacingHistogram::BINS; b++) {
+        if (toSim.bins[b] || toSwap.bins[b] || toGpu.bins[b]) last = b;
+    }
+    for (int b = 0; b <= last; b++) {
+        fprintf(f, "%.3f,%.3f,%u,%u,%u\n", b * PacingHistogram::BIN_MS, (b + 1) * PacingHistogram::BIN_MS,
+            toSim.bins[b], toSwap.bins[b], toGpu.bins[b]);
+    }
+    bool ok = fclose(f) == 0;
+    if (ok) printf("Latency histogram written to %s\n", path);
+    return ok;
+}
@@ -0,0 +1,55 @@
+// latency_meter.h
+// Hop Hop Bunny - input-to-photon latency
+// A flap's input is stamped in the GLFW callback and carried with the flap. When a sim tick
+// applies it, the frame being built is the first to show the bunny's new velocity; that
+// frame's glfwSwapBuffers return and a glFenceSync issued right after it (signalled once the
+// GPU has executed everything up to and including the swap) close the measurement. Stages:
+//   sim    input -> the tick that applied the flap
+//   swap   input -> glfwSwapBuffers returned for that frame
+//   gpu    input -> the frame's fence signalled
+// Scanout comes after gpu by up to one refresh, which the GL can't observe.
+// Only frames that carry a flap get a fence. It goes into a small ring and every later
+// framePresented() polls the ring with a zero timeout, so measuring never stalls the frame it
+// measures; gpu is therefore the first poll that saw the fence signalled, late by up to a frame.
+// A fence still unsignalled after 100 ms, or pushed out of a full ring, is dropped from gpu.
+// drainGpu calls glFinish after every swap, so no frame is ever queued behind another. That is
+// a pacing mode to compare against, not late latching: input is still read at the frame start.
+
+#pragma once
+
+#include "frame_pacer.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+class LatencyMeter {
+public:
+    bool measuring = false;           // --latency
+    bool drainGpu = false;            // --gpu-drain
+
+    // A sim tick applied a flap whose input arrived at inputNs (profNowNs time). The first one
+    // per frame counts.
+    void flapApplied(int64_t inputNs);
+    // Right after glfwSwapBuffers.
+    void framePresented();
+
+    // Summary of each stage; rows prints the histograms too.
+    void printReport(const char* modeLabel, bool rows) const;
+    // The three histograms side by side as CSV (bin start/end in ms, counts per stage), with
+    // the mode and summary as '#' comment lines.
+    bool writeCsv(const char* path, const char* modeLabel) const;
+
+private:
+    struct Pending {
+        GLsync fence;
+        int64_t inputNs, swapNs;
+    };
+    static constexpr int PENDING = 8;   // a flap per frame for 8 frames of GPU queue
+    Pending pending[PENDING] = {};
+    int pendingHead = 0, pendingCount = 0;
+    void pollFences();
+
+    int64_t frameInputNs = 0, frameSimNs = 0;   // the flap this frame carries, 0 = none
+    PacingHistogram toSim, toSwap, toGpu;
+};
@@ -0,0 +1,63 @@
+// pcg32.h
+// Hop Hop Bunny - seedable, splittable random numbers
+// PCG32 (XSH RR, pcg-random.org): a 64-bit LCG stepped once per draw, its output permuted down
+// to 32 bits. The seed picks the starting point and the stream the increment, so every
+// (seed, stream) pair is its own sequence. advance() jumps ahead in O(log n) steps, which lets
+// a worker start anywhere in a sequence without drawing what comes before it.
+// Plain value type: copy it to fork, compare it to check two runs are in the same place.
+
+#pragma once
+
+#include <cstdint>
+
+struct Pcg32 {
+    static const uint64_t MULT = 6364136223846793005ull;
+
+    uint64_t state = 0x853C49E6748FEA9Bull;
+    uint64_t inc = 0xDA3E39CB94B95BDBull;   // always odd
+
+    Pcg32() {}
+    Pcg32(uint64_t seed, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1u;
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * MULT + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+    }
+
+    // uniform float in [0,1) from the top 24 bits
+    float unit() { return (float)(next() >> 8) * (1.0f / 16777216.0f); }
+
+    // Same as calling next() delta times.
+    void advance(uint64_t delta) {
+        uint64_t curMult = MULT, curPlus = inc, accMult = 1, accPlus = 0;
+        while (delta > 0) {
+            if (delta & 1) {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            delta >>= 1;
+        }
+        state = accMult * state + accPlus;
+    }
+
+    // A new generator on its own stream, seeded from this one (which moves on by three draws).
+    Pcg32 split() {
+        uint64_t hi = next();
+        uint64_t seed = hi << 32 | next();
+        return Pcg32(seed, next());
+    }
+
+    bool operator==(const Pcg32& o) const { return state == o.state && inc == o.inc; }
+    bool operator!=(const Pcg32& o) const { return !(*this == o); }
+};
@@ -0,0 +1,122 @@
+// profiler.cpp
+// Hop Hop Bunny - frame profiler
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+Profiler gProfiler;
+
+const char* profPhaseName(int phase) {
+    static const char* names[PROF_PHASE_COUNT] = {
+        "frame", "poll", "assets", "input", "sim", "spawn", "scroll", "collision",
+        "clouds", "clear", "grass", "pipes", "bunny", "score", "buttons",
+        "overlay", "swap", "pace",
+    };
+    return phase >= 0 && phase < PROF_PHASE_COUNT ? names[phase] : "?";
+}
+
+void Profiler::setEnabled(bool on) {
+    enabled = on;
+    if (!on) inFrame = false;
+}
+
+void Profiler::beginFrame() {
+    if (!enabled) return;
+    int64_t now = profNowNs();
+    if (inFrame) {
+        record(PROF_FRAME, cur.startNs, now);
+        ring[frameCount++ % FRAME_RING] = cur;
+    }
+    cur = FrameSample();
+    cur.startNs = now;
+    inFrame = true;
+}
+
+void Profiler::recordGpu(uint64_t frame, int phase, float ms) {
+    FrameSample* s = frame == frameCount ? &cur : frame < frameCount && frameCount - frame <= FRAME_RING ? &ring[frame % FRAME_RING] : nullptr;
+    if (!s) return;
+    s->gpuMs[phase] += ms;
+    if (phase != PROF_FRAME) s->gpuMs[PROF_FRAME] += ms;
+}
+
+float Profiler::percentileMs(int phase, float q, bool gpu) const {
+    float v[FRAME_RING];
+    int n = 0;
+    for (int i = 0; i < frames(); i++) {
+        const FrameSample& s = frame(i);
+        if (!gpu) v[n++] = s.phaseMs[phase];
+        else if (s.gpuMs[PROF_FRAME] > 0.0f) v[n++] = s.gpuMs[phase];
+    }
+    if (n == 0) return 0.0f;
+    int k = std::min(n - 1, std::max(0, (int)(q * (n - 1) + 0.5f)));
+    std::nth_element(v, v + k, v + n);
+    return v[k];
+}
+
+bool Profiler::writeChromeTrace(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (!f) { fprintf(stderr, "Cannot write trace %s\n", path); return false; }
+
+    // oldest event first; once the ring has wrapped only the newest EVENT_RING remain
+    uint64_t first = eventCount > EVENT_RING ? eventCount - EVENT_RING : 0;
+    int64_t t0 = first < eventCount ? events[first & (EVENT_RING - 1)].startNs : 0;
+    for (uint64_t i = first; i < eventCount; i++) t0 = std::min(t0, events[i & (EVENT_RING - 1)].startNs);
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+    for (uint64_t i = first; i < eventCount; i++) {
+        const ProfEvent& e = events[i & (EVENT_RING - 1)];
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+            profPhaseName(e.phase), (e.startNs - t0) * 1e-3, e.durNs * 1e-3);
+    }
+    // GPU pass times as a counter track, one sample per frame still in the ring
+    for (int i = frames() - 1; i >= 0; i--) {
+        const FrameSample& s = frame(i);
+        if (s.startNs < t0 || s.gpuMs[PROF_FRAME] <= 0.0f) continue;
+        fprintf(f, ",\n{\"name\":\"gpu ms\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{", (s.startNs - t0) * 1e-3);
+        bool first = true;
+        for (int p = 1; p < PROF_PHASE_COUNT; p++) {
+            if (s.gpuMs[p] <= 0.0f) continue;
+            fprintf(f, "%s\"%s\":%.4f", first ? "" : ",", profPhaseName(p), s.gpuMs[p]);
+            first = false;
+        }
+        fprintf(f, "}}");
+    }
+    fprintf(f, "\n]}\n");
+    bool ok = fclose(f) == 0;
+    if (ok) printf("Trace: %llu events -> %s\n", (unsigned long long)(eventCount - first), path);
+    return ok;
+}
+
+void Profiler::printSummary() const {
+    int n = frames();
+    if (n == 0) return;
+    bool haveGpu = percentileMs(PROF_FRAME, 1.0f, true) > 0.0f;
+    printf("Profile over the last %d frames:\n  %-12s %9s %8s", n, "phase", "p50 ms", "p99 ms");
+    if (haveGpu) printf(" %9s %8s", "gpu p50", "gpu p99");
+    printf("\n");
+    for (int p = 0; p < PROF_PHASE_COUNT; p++) {
+        float p99 = percentileMs(p, 0.99f), g99 = haveGpu ? percentileMs(p, 0.99f, true) : 0.0f;
+        if (p99 <= 0.0f && g99 <= 0.0f) continue;
+        printf("  %-12s %9.3f %8.3f", profPhaseName(p), percentileMs(p, 0.5f), p99);
+        if (haveGpu) printf(" %9.3f %8.3f", percentileMs(p, 0.5f, true), g99);
+        printf("\n");
+    }
+
+    // swap is where the CPU waits for vsync or for the GPU to catch up and pace is the frame
+    // limiter, so both are left out of the CPU side; whichever side is busier per frame is what
+    // limits the frame rate
+    float cpu[FRAME_RING];
+    for (int i = 0; i < n; i++) cpu[i] = frame(i).phaseMs[PROF_FRAME] - frame(i).phaseMs[PROF_SWAP] - frame(i).phaseMs[PROF_PACE];
+    std::nth_element(cpu, cpu + n / 2, cpu + n);
+    float frameMs = percentileMs(PROF_FRAME, 0.5f);
+    if (!haveGpu) {
+        printf("  CPU work p50 %.3f ms of a %.3f ms frame (no GPU timings)\n", cpu[n / 2], frameMs);
+        return;
+    }
+    float gpu = percentileMs(PROF_FRAME, 0.5f, true);
+    const char* bound = std::max(cpu[n / 2], gpu) < frameMs * 0.8f ? "neither, waiting on vsync" : cpu[n / 2] >= gpu ? "CPU-bound" : "GPU-bound";
+    printf("  CPU work p50 %.3f ms, GPU p50 %.3f ms of a %.3f ms frame: %s\n", cpu[n / 2], gpu, frameMs, bound);
+}
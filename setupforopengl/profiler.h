@@ -0,0 +1,103 @@
+// profiler.h
+// Hop Hop Bunny - frame profiler
+// Scoped CPU timers around the main loop phases. Each scope is appended to a ring of trace
+// events (written out as Chrome trace JSON: chrome://tracing or ui.perfetto.dev) and summed
+// into the current frame's sample; the last FRAME_RING samples give the p50/p99 numbers for
+// the overlay and the exit summary. GPU pass times (gpu_timer.h) arrive a few frames late and
+// are filled into the sample of the frame that issued them. Main thread only.
+// Disabled (the default) a scope costs one branch on gProfiler.enabled; building with
+// HHB_PROFILE=0 removes the scopes altogether.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#ifndef HHB_PROFILE
+#define HHB_PROFILE 1
+#endif
+
+// PROF_FRAME is the whole frame (start of one beginFrame() to the next); the rest are scopes.
+// Pace is the frame limiter's wait (frame_pacer.h); like swap it is waiting, not work.
+// Spawn, scroll (moving, scoring and culling pipes) and collision run inside the sim ticks,
+// so their time is also part of PROF_SIM; game_sim.cpp only has them with HHB_SIM_PROFILE.
+enum ProfPhase : uint8_t {
+    PROF_FRAME, PROF_POLL, PROF_ASSETS, PROF_INPUT, PROF_SIM, PROF_SPAWN, PROF_SCROLL, PROF_COLLISION,
+    PROF_CLOUDS, PROF_CLEAR, PROF_GRASS, PROF_PIPES, PROF_BUNNY, PROF_SCORE, PROF_BUTTONS,
+    PROF_OVERLAY, PROF_SWAP, PROF_PACE, PROF_PHASE_COUNT
+};
+
+const char* profPhaseName(int phase);
+
+inline int64_t profNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ProfEvent {
+    int64_t startNs, durNs;
+    uint8_t phase;
+};
+
+struct FrameSample {
+    int64_t startNs = 0;
+    float phaseMs[PROF_PHASE_COUNT] = {};   // summed over every scope of that phase in the frame
+    float gpuMs[PROF_PHASE_COUNT] = {};     // GPU time per pass; [PROF_FRAME] is their sum, 0 = no data (yet)
+};
+
+struct Profiler {
+    static const int EVENT_RING = 1 << 16;   // power of two; ~50 s of trace at 60 fps
+    static const int FRAME_RING = 512;
+
+    bool enabled = false;
+
+    // Turning it on starts with the next beginFrame(), so no half-timed frame gets in.
+    void setEnabled(bool on);
+
+    // Call once at the top of the main loop; closes the previous frame's sample.
+    void beginFrame();
+
+    void record(int phase, int64_t startNs, int64_t endNs) {
+        events[eventCount++ & (EVENT_RING - 1)] = { startNs, endNs - startNs, (uint8_t)phase };
+        cur.phaseMs[phase] += (float)(endNs - startNs) * 1e-6f;
+    }
+
+    // GPU results for frame index frame (frameIndex() when it was issued); dropped once the
+    // frame has left the ring.
+    void recordGpu(uint64_t frame, int phase, float ms);
+    uint64_t frameIndex() const { return frameCount; }   // index of the frame in progress
+
+    int frames() const { return frameCount < FRAME_RING ? (int)frameCount : FRAME_RING; }
+    const FrameSample& frame(int back) const { return ring[(frameCount - 1 - back) % FRAME_RING]; }   // 0 = latest
+
+    // q in [0, 1] over the complete frames in the ring; 0 when there are none. For GPU times
+    // only frames whose results have arrived count.
+    float percentileMs(int phase, float q, bool gpu = false) const;
+
+    bool writeChromeTrace(const char* path) const;
+    void printSummary() const;
+
+private:
+    ProfEvent events[EVENT_RING];
+    uint64_t eventCount = 0;
+    FrameSample ring[FRAME_RING];
+    uint64_t frameCount = 0;
+    FrameSample cur;
+    bool inFrame = false;
+};
+
+extern Profiler gProfiler;
+
+struct ProfScope {
+    int phase;
+    int64_t start;
+    explicit ProfScope(int p) : phase(p), start(gProfiler.enabled ? profNowNs() : 0) {}
+    ~ProfScope() { if (start) gProfiler.record(phase, start, profNowNs()); }
+};
+
+#if HHB_PROFILE
+#define PROF_CONCAT2(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT2(a, b)
+#define PROFILE_SCOPE(phase) ProfScope PROF_CONCAT(profScope_, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#endif
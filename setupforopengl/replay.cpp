@@ -0,0 +1,388 @@
+// replay.cpp
+// Hop Hop Bunny - input recording and playback
+
+#include "replay.h"
+
+#include <chrono>
+#include <cstring>
+
+size_t encodeFlaps(const uint32_t* ticks, size_t n, uint8_t* out) {
+    size_t size = 0;
+    uint32_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        size += putVarint(out + size, ticks[i] - next);
+        next = ticks[i] + 1;
+    }
+    return size;
+}
+
+bool decodeFlaps(const uint8_t* in, size_t size, uint32_t* ticks, size_t n) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + size;
+    uint64_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = 0;
+        int shift = 0;
+        for (;;) {
+            if (p == end || shift > 28) return false;
+            uint8_t b = *p++;
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+            shift += 7;
+        }
+        next += v;
+        if (next > 0xFFFFFFFFull) return false;
+        ticks[i] = (uint32_t)next;
+        next++;
+    }
+    return p == end;
+}
+
+void Replay::begin(const GameParams& P, uint32_t runSeed) {
+    seed = runSeed;
+    params = P;
+    params.birdMask = nullptr;
+    hasMask = P.birdMask != nullptr;
+    if (hasMask) mask = *P.birdMask;
+    buildHash = replayBuildHash();
+    flaps.clear();
+    endTick = 0; score = 0; died = false; stateHash = 0;
+}
+
+void Replay::finish(const GameSim& sim) {
+    endTick = sim.tick;
+    score = sim.score;
+    died = sim.dead;
+    stateHash = replayStateHash(sim);
+}
+
+GameParams Replay::gameParams() const {
+    GameParams P = params;
+    P.birdMask = hasMask ? &mask : nullptr;
+    return P;
+}
+
+bool replayRulesMatch(const Replay& r, const GameParams& P, const char** why) {
+    auto differs = [&](const char* what) { if (why) *why = what; return false; };
+    const GameParams& R = r.params;
+    // compared as bits: the same rules are the same floats
+    auto same = [](float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; };
+    if (!same(R.birdX, P.birdX) || !same(R.birdRadius, P.birdRadius) || !same(R.pipeSpeed, P.pipeSpeed) ||
+        !same(R.spawnInterval, P.spawnInterval) || !same(R.pipeWidth, P.pipeWidth) || !same(R.pipeGapSize, P.pipeGapSize) ||
+        !same(R.flapStrength, P.flapStrength) || !same(R.gravity, P.gravity) || !same(R.fixedDt, P.fixedDt))
+        return differs("game constants differ");
+    if (R.godMode != P.godMode) return differs("god mode differs");
+    if (r.hasMask != (P.birdMask != nullptr)) return differs("hitbox kind differs");
+    if (r.hasMask) {
+        const CollisionMask& m = *P.birdMask;
+        if (!same(r.mask.halfW, m.halfW) || !same(r.mask.halfH, m.halfH) || std::memcmp(r.mask.rows, m.rows, sizeof(m.rows)) != 0)
+            return differs("hitbox differs");
+    }
+    static const uint64_t build = replayBuildHash();
+    if (r.buildHash != build) return differs("recorded by another build");
+    return true;
+}
+
+static void hashBytes(uint64_t& h, const void* p, size_t n) {
+    const unsigned char* b = (const unsigned char*)p;
+    for (size_t i = 0; i < n; i++) { h ^= b[i]; h *= 0x100000001B3ull; }
+}
+
+uint64_t replayBuildHash() {
+    char id[256];
+#if defined(_MSC_VER)
+    std::snprintf(id, sizeof(id), "msvc %d", _MSC_FULL_VER);
+#elif defined(__VERSION__)
+    std::snprintf(id, sizeof(id), "%s", __VERSION__);
+#else
+    std::snprintf(id, sizeof(id), "unknown compiler");
+#endif
+#if defined(_M_X64) || defined(__x86_64__)
+    const char* target = "x64";
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const char* target = "arm64";
+#else
+    const char* target = "other";
+#endif
+    uint64_t h = 0xCBF29CE484222325ull;
+    uint32_t rev = GAME_SIM_REVISION;
+    hashBytes(h, &rev, sizeof(rev));
+    hashBytes(h, id, std::strlen(id));
+    hashBytes(h, target, std::strlen(target));
+    return h;
+}
+
+uint64_t replayStateHash(const GameSim& sim) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    hashBytes(h, &sim.birdY, sizeof(float));
+    hashBytes(h, &sim.birdVel, sizeof(float));
+    hashBytes(h, &sim.timeSinceSpawn, sizeof(float));
+    hashBytes(h, &sim.score, sizeof(int));
+    hashBytes(h, &sim.tick, sizeof(uint32_t));
+    hashBytes(h, &sim.rng.state, sizeof(uint64_t));
+    uint8_t flags = (sim.dead ? 1 : 0) | (sim.firstFlapDone ? 2 : 0);
+    hashBytes(h, &flags, 1);
+    for (const Pipe& p : sim.pipes) {
+        hashBytes(h, &p.x, sizeof(float));
+        hashBytes(h, &p.gapY, sizeof(float));
+        uint8_t scored = p.scored ? 1 : 0;
+        hashBytes(h, &scored, 1);
+    }
+    return h;
+}
+
+// Header and hitbox for a run about to start; out needs sizeof(ReplayHeader) + sizeof(ReplayMask).
+static size_t putHeader(uint8_t* out, const GameParams& P, const CollisionMask* mask, uint32_t seed, uint64_t buildHash) {
+    ReplayHeader h = {};
+    std::memcpy(h.magic, REPLAY_MAGIC, 4);
+    h.version = REPLAY_VERSION;
+    h.flags = 0;
+    if (mask) h.flags |= REPLAY_MASK;
+    if (P.godMode) h.flags |= REPLAY_GOD_MODE;
+    h.seed = seed;
+    h.buildHash = buildHash;
+    h.birdX = P.birdX; h.birdRadius = P.birdRadius; h.pipeSpeed = P.pipeSpeed;
+    h.spawnInterval = P.spawnInterval; h.pipeWidth = P.pipeWidth; h.pipeGapSize = P.pipeGapSize;
+    h.flapStrength = P.flapStrength; h.gravity = P.gravity; h.fixedDt = P.fixedDt;
+    std::memcpy(out, &h, sizeof(h));
+    if (!mask) return sizeof(h);
+
+    ReplayMask m;
+    m.halfW = mask->halfW;
+    m.halfH = mask->halfH;
+    std::memcpy(m.rows, mask->rows, sizeof(m.rows));
+    std::memcpy(out + sizeof(h), &m, sizeof(m));
+    return sizeof(h) + sizeof(m);
+}
+
+static ReplayTrailer makeTrailer(bool died, uint64_t stateHash, uint32_t endTick, int score, uint32_t flapCount) {
+    ReplayTrailer t = {};
+    std::memcpy(t.magic, REPLAY_END_MAGIC, 4);
+    t.flags = died ? (uint32_t)REPLAY_DIED : 0u;
+    t.stateHash = stateHash;
+    t.endTick = endTick;
+    t.score = score;
+    t.flapCount = flapCount;
+    return t;
+}
+
+void serializeReplay(const Replay& r, std::vector<uint8_t>& out) {
+    out.resize(sizeof(ReplayHeader) + sizeof(ReplayMask) + r.flaps.size() * REPLAY_MAX_VARINT + sizeof(ReplayTrailer));
+    size_t size = putHeader(out.data(), r.params, r.hasMask ? &r.mask : nullptr, r.seed, r.buildHash);
+    size += encodeFlaps(r.flaps.data(), r.flaps.size(), out.data() + size);
+
+    ReplayTrailer t = makeTrailer(r.died, r.stateHash, r.endTick, r.score, (uint32_t)r.flaps.size());
+    std::memcpy(out.data() + size, &t, sizeof(t));
+    out.resize(size + sizeof(t));
+}
+
+bool saveReplay(const char* path, const Replay& r) {
+    std::vector<uint8_t> bytes;
+    serializeReplay(r, bytes);
+    FILE* f = std::fopen(path, "wb");
+    bool ok = f && std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    if (f) ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::fprintf(stderr, "cannot write replay %s\n", path);
+    return ok;
+}
+
+bool parseReplay(const uint8_t* data, size_t size, Replay& r, const char** error) {
+    auto fail = [&](const char* why) { if (error) *error = why; return false; };
+
+    ReplayHeader h;
+    ReplayTrailer t;
+    if (size < sizeof(h) + sizeof(t)) return fail("too short for a replay");
+    std::memcpy(&h, data, sizeof(h));
+    std::memcpy(&t, data + size - sizeof(t), sizeof(t));
+    if (std::memcmp(h.magic, REPLAY_MAGIC, 4) != 0) return fail("not a replay");
+    if (h.version != REPLAY_VERSION) return fail("replay version mismatch");
+    if (std::memcmp(t.magic, REPLAY_END_MAGIC, 4) != 0) return fail("no trailer (recording cut short?)");
+
+    r = Replay();
+    r.seed = h.seed;
+    r.buildHash = h.buildHash;
+    GameParams& P = r.params;
+    P.birdX = h.birdX; P.birdRadius = h.birdRadius; P.pipeSpeed = h.pipeSpeed;
+    P.spawnInterval = h.spawnInterval; P.pipeWidth = h.pipeWidth; P.pipeGapSize = h.pipeGapSize;
+    P.flapStrength = h.flapStrength; P.gravity = h.gravity; P.fixedDt = h.fixedDt;
+    P.godMode = (h.flags & REPLAY_GOD_MODE) != 0;
+    if (!(P.fixedDt > 0.0f)) return fail("bad tick length");
+    r.endTick = t.endTick;
+    r.score = t.score;
+    r.died = (t.flags & REPLAY_DIED) != 0;
+    r.stateHash = t.stateHash;
+
+    size_t pos = sizeof(h), streamEnd = size - sizeof(t);
+    if (h.flags & REPLAY_MASK) {
+        ReplayMask m;
+        if (streamEnd - pos < sizeof(m)) return fail("truncated hitbox");
+        std::memcpy(&m, data + pos, sizeof(m));
+        pos += sizeof(m);
+        r.hasMask = true;
+        r.mask.halfW = m.halfW;
+        r.mask.halfH = m.halfH;
+        std::memcpy(r.mask.rows, m.rows, sizeof(m.rows));
+        r.mask.finish();
+    }
+
+    // a flap takes at least a byte and a tick
+    if (t.flapCount > streamEnd - pos || t.flapCount > t.endTick) return fail("bad flap count");
+    r.flaps.resize(t.flapCount);
+    if (!decodeFlaps(data + pos, streamEnd - pos, r.flaps.data(), r.flaps.size())) return fail("corrupt flap stream");
+    if (!r.flaps.empty() && r.flaps.back() >= r.endTick) return fail("flap after the end of the run");
+    return true;
+}
+
+bool loadReplay(const char* path, Replay& r) {
+    FILE* f = std::fopen(path, "rb");
+    if (!f) { std::fprintf(stderr, "cannot open replay %s\n", path); return false; }
+    std::vector<uint8_t> bytes;
+    std::fseek(f, 0, SEEK_END);
+    long n = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    if (n > 0) {
+        bytes.resize((size_t)n);
+        if (std::fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) bytes.clear();
+    }
+    std::fclose(f);
+    const char* error = nullptr;
+    if (parseReplay(bytes.data(), bytes.size(), r, &error)) return true;
+    std::fprintf(stderr, "%s: %s\n", path, error);
+    return false;
+}
+
+ReplayResult playReplay(const Replay& r, GameSim& sim) {
+    sim.reset(r.seed);
+    size_t next = 0;
+    while (sim.tick < r.endTick && !sim.dead) sim.step(r.input(sim, next));
+
+    ReplayResult res;
+    res.ticks = sim.tick;
+    res.score = sim.score;
+    res.died = sim.dead;
+    res.stateHash = replayStateHash(sim);
+    res.matches = res.ticks == r.endTick && res.score == r.score && res.died == r.died && res.stateHash == r.stateHash;
+    return res;
+}
+
+ReplayWriter::ReplayWriter() {
+    cur = &chunks[0];
+    for (int i = 1; i < CHUNKS; i++) spare.push(&chunks[i]);
+}
+
+ReplayWriter::~ReplayWriter() {
+    if (!thread.joinable()) return;   // never recorded
+    {
+        std::lock_guard<std::mutex> lk(m);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void ReplayWriter::setLive(bool live) {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        runLive = live;
+    }
+    wake.notify_one();
+}
+
+void ReplayWriter::begin(const char* path, const GameParams& P, uint32_t runSeed) {
+    static_assert(sizeof(ReplayHeader) + sizeof(ReplayMask) <= CHUNK_BYTES, "header fits a chunk");
+    if (!thread.joinable()) thread = std::thread(&ReplayWriter::writerLoop, this);
+    if (cur->size) submit(Chunk::DATA);   // leftovers of a run that was never finished
+    cur->path = path;
+    cur->size = (int)putHeader(cur->data, P, P.birdMask, runSeed, replayBuildHash());
+    active = submit(Chunk::OPEN);
+    nextTick = 0;
+    flapCount = 0;
+    setLive(active);
+}
+
+void ReplayWriter::finish(const GameSim& sim) {
+    if (!active) return;
+    if (cur->size > CHUNK_BYTES - (int)sizeof(ReplayTrailer) && !submit(Chunk::DATA)) return;
+    ReplayTrailer t = makeTrailer(sim.dead, replayStateHash(sim), sim.tick, sim.score, flapCount);
+    std::memcpy(cur->data + cur->size, &t, sizeof(t));
+    cur->size += (int)sizeof(t);
+    submit(Chunk::CLOSE);
+    active = false;
+    setLive(false);
+}
+
+bool ReplayWriter::submit(Chunk::Kind kind) {
+    Chunk* next = spare.pop();
+    if (!next) {
+        // the writer has every other chunk: lose this one and with it the rest of the run
+        dropped++;
+        active = false;
+        runLive.store(false);   // no lock here; the writer goes back to sleep at its next poll
+        cur->size = 0;
+        cur->path = nullptr;
+        return false;
+    }
+    cur->kind = kind;
+    full.push(cur);
+    submitted++;
+    cur = next;
+    cur->size = 0;
+    cur->path = nullptr;
+    return true;
+}
+
+ReplayWriter::Report ReplayWriter::flush() {
+    std::unique_lock<std::mutex> lk(m);
+    wake.notify_one();
+    idle.wait(lk, [&] { return completed.load() == submitted; });
+    Report r;
+    r.ok = !failed;
+    r.failed = failedPath;
+    r.saved = saved;
+    r.lastSaved = lastSaved;
+    r.droppedChunks = dropped;
+    return r;
+}
+
+void ReplayWriter::writerLoop() {
+    FILE* f = nullptr;
+    const char* path = nullptr;
+    for (;;) {
+        Chunk* c = full.pop();
+        if (!c) {
+            std::unique_lock<std::mutex> lk(m);
+            if (stopping && full.empty()) break;   // everything is written
+            // record() never signals (that could block the frame), so during a run the writer
+            // polls; between runs it sleeps until begin(), flush() or the destructor wakes it
+            auto work = [&] { return stopping || !full.empty(); };
+            if (runLive) wake.wait_for(lk, std::chrono::milliseconds(POLL_MS), work);
+            else wake.wait(lk, [&] { return work() || runLive; });
+            continue;
+        }
+
+        bool ok = true, closed = false;
+        if (c->kind == Chunk::OPEN) {
+            if (f) std::fclose(f);   // a run that was never finished stays without its trailer
+            path = c->path;
+            f = std::fopen(path, "wb");
+        }
+        if (!f) ok = false;
+        else if (c->size) ok = std::fwrite(c->data, 1, (size_t)c->size, f) == (size_t)c->size;
+        if (c->kind == Chunk::CLOSE && f) {
+            ok = std::fclose(f) == 0 && ok;
+            f = nullptr;
+            closed = ok;
+        }
+        if (ok) written.fetch_add((uint64_t)c->size, std::memory_order_relaxed);
+        spare.push(c);
+
+        {
+            std::lock_guard<std::mutex> lk(m);
+            if (!ok) { failed = true; failedPath = path; }
+            if (closed) { saved++; lastSaved = path; }
+            completed.fetch_add(1);
+        }
+        idle.notify_all();
+    }
+    if (f) std::fclose(f);
+}
@@ -0,0 +1,243 @@
+// replay.h
+// Hop Hop Bunny - input recording and playback
+// The sim is deterministic, so a run is fully described by its seed, its params (hitbox
+// included) and the ticks on which InputFrame.flap was set. A replay stores exactly that, plus
+// how the run ended (tick count, score, a hash of the final world) so playback can prove it
+// reproduced the run bit for bit. The build hash says which sim revision and compiler made it;
+// bit-exact playback assumes the same, like --verify-batch.
+//
+// Layout (little-endian): ReplayHeader | ReplayMask if REPLAY_MASK | flap stream | ReplayTrailer.
+// The flap stream is one LEB128 varint per flap: ticks since the previous flap, minus one (the
+// first counts from tick 0). Flaps are rarely more than 127 ticks apart, so a flap is one byte
+// and an hour of play a few KB. Everything before the trailer is known when the run starts, so
+// a recording can be streamed out as it is played (ReplayWriter) and closed with the trailer.
+
+#pragma once
+
+#include "game_sim.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char REPLAY_MAGIC[4] = { 'H', 'H', 'B', 'R' };
+static const char REPLAY_END_MAGIC[4] = { 'H', 'H', 'B', 'E' };
+static const uint32_t REPLAY_VERSION = 2;
+
+enum ReplayFlags : uint32_t {
+    REPLAY_MASK = 1u << 0,       // header: pixel hitbox follows the header
+    REPLAY_GOD_MODE = 1u << 1,   // header
+    REPLAY_DIED = 1u << 2,       // trailer: the run ended in a death at endTick, not by quitting
+};
+
+struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t seed;
+    uint64_t buildHash;                             // replayBuildHash() of the recording build
+    float birdX, birdRadius, pipeSpeed, spawnInterval, pipeWidth, pipeGapSize, flapStrength, gravity, fixedDt;
+    uint32_t reserved;
+};
+
+struct ReplayMask {
+    float halfW, halfH;
+    uint64_t rows[CollisionMask::SIZE];
+};
+
+struct ReplayTrailer {
+    char magic[4];
+    uint32_t flags;
+    uint64_t stateHash;                             // replayStateHash() at endTick
+    uint32_t endTick;                               // ticks played
+    int32_t score;
+    uint32_t flapCount;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ReplayHeader) == 64, "replay header layout");
+static_assert(sizeof(ReplayMask) == 8 + 8 * CollisionMask::SIZE, "replay mask layout");
+static_assert(sizeof(ReplayTrailer) == 32, "replay trailer layout");
+
+// Varint coding of the flap stream. An encoded flap is at most REPLAY_MAX_VARINT bytes.
+static const int REPLAY_MAX_VARINT = 5;
+inline int putVarint(uint8_t* out, uint32_t v) {
+    int n = 0;
+    while (v >= 0x80) { out[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+// Encodes ascending ticks; out needs n * REPLAY_MAX_VARINT bytes. Returns the bytes used.
+size_t encodeFlaps(const uint32_t* ticks, size_t n, uint8_t* out);
+// Decodes exactly n flaps from [in, in + size). False if the stream is short, long or malformed.
+bool decodeFlaps(const uint8_t* in, size_t size, uint32_t* ticks, size_t n);
+
+struct Replay {
+    uint32_t seed = 0;
+    GameParams params;                              // birdMask unused, see gameParams()
+    bool hasMask = false;
+    CollisionMask mask;
+    uint64_t buildHash = 0;
+    std::vector<uint32_t> flaps;                    // ticks with a flap, ascending
+
+    // how the run ended
+    uint32_t endTick = 0;
+    int score = 0;
+    bool died = false;
+    uint64_t stateHash = 0;
+
+    // Starts a recording: keeps P (and a copy of its hitbox) and the seed GameSim was reset with.
+    void begin(const GameParams& P, uint32_t runSeed);
+    // Call with the InputFrame about to be stepped (sim.tick is the tick it lands on).
+    void record(const GameSim& sim, const InputFrame& in) {
+        if (in.flap && !sim.dead) flaps.push_back(sim.tick);
+    }
+    void finish(const GameSim& sim);
+
+    // The params to play with; the hitbox points into this object, so keep it alive.
+    GameParams gameParams() const;
+    // Input for the tick sim is about to step; next is the caller's cursor into flaps, from 0.
+    InputFrame input(const GameSim& sim, size_t& next) const {
+        InputFrame in;
+        while (next < flaps.size() && flaps[next] < sim.tick) next++;
+        in.flap = next < flaps.size() && flaps[next] == sim.tick;
+        return in;
+    }
+};
+
+// Both print the reason on failure.
+bool saveReplay(const char* path, const Replay& r);
+bool loadReplay(const char* path, Replay& r);
+
+// The same bytes in memory, for replays that travel some other way than a file.
+void serializeReplay(const Replay& r, std::vector<uint8_t>& out);
+bool parseReplay(const uint8_t* data, size_t size, Replay& r, const char** error);
+
+// Whether r was recorded by this build under exactly the rules P (constants, god mode and
+// hitbox), which a verifier plays it with instead of the replay's own; *why says what differs.
+bool replayRulesMatch(const Replay& r, const GameParams& P, const char** why);
+
+// Identifies what decides whether a replay plays back bit for bit: GAME_SIM_REVISION, the
+// compiler and the target.
+uint64_t replayBuildHash();
+
+// FNV-1a over everything that decides the rest of a run: bird, pipes, score, tick, generator.
+uint64_t replayStateHash(const GameSim& sim);
+
+struct ReplayResult {
+    uint32_t ticks = 0;
+    int score = 0;
+    bool died = false;
+    uint64_t stateHash = 0;
+    bool matches = false;                           // all of the above equal the recording
+};
+
+// Plays r from reset to its endTick (or an earlier death) in sim, which must have been built
+// with r.gameParams().
+ReplayResult playReplay(const Replay& r, GameSim& sim);
+
+// Records runs straight to disk for the game loop. record() only appends a varint to a fixed
+// chunk; full chunks are handed to a writer thread that does the file I/O through a lock-free
+// single-producer ring, and come back through another. The caller never waits on the writer
+// and never allocates: all CHUNKS chunks exist from the start, and when the writer is so far
+// behind that none is free the chunk is dropped (counted in the Report) and the rest of that
+// run is not recorded, so its file ends without a trailer and won't load. Runs are written in
+// order; starting a new one while the last is still being written is fine.
+// The writer thread starts with the first begin(). It looks for chunks every POLL_MS while a
+// run is being recorded and sleeps until woken otherwise, so an idle writer costs nothing.
+class ReplayWriter {
+public:
+    static const int CHUNK_BYTES = 4096;
+    static const int CHUNKS = 16;                   // power of two, allocated up front
+    static const int POLL_MS = 1;                   // how often the writer looks for chunks during a run
+
+    ReplayWriter();
+    ~ReplayWriter();                                // writes whatever is queued, then stops
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    // path must stay valid until the run is on disk (argv, a literal).
+    void begin(const char* path, const GameParams& P, uint32_t runSeed);
+    void record(const GameSim& sim, const InputFrame& in) {
+        if (!active || !in.flap || sim.dead) return;
+        if (cur->size > CHUNK_BYTES - REPLAY_MAX_VARINT && !submit(Chunk::DATA)) return;
+        cur->size += putVarint(cur->data + cur->size, sim.tick - nextTick);
+        nextTick = sim.tick + 1;
+        flapCount++;
+    }
+    // Queues the trailer and the close; returns at once.
+    void finish(const GameSim& sim);
+    bool recording() const { return active; }
+
+    // Everything since the writer started. The writer prints nothing; the caller reports failures.
+    struct Report {
+        bool ok = true;                             // no write failed
+        const char* failed = nullptr;               // path of the latest failure
+        int saved = 0;                              // runs closed with their trailer
+        const char* lastSaved = nullptr;            // path of the latest of them
+        uint32_t droppedChunks = 0;                 // chunks the writer had no room for
+    };
+    // Blocks until everything queued so far is on disk.
+    Report flush();
+    uint64_t bytesWritten() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk {
+        enum Kind { OPEN, DATA, CLOSE } kind = DATA;
+        const char* path = nullptr;
+        int size = 0;
+        uint8_t data[CHUNK_BYTES];
+    };
+
+    // One thread pushes, the other pops. Every chunk is in at most one ring, so a push can't fail.
+    struct ChunkRing {
+        Chunk* slots[CHUNKS];
+        std::atomic<uint32_t> head{ 0 };            // written by the consumer
+        std::atomic<uint32_t> tail{ 0 };            // written by the producer
+        void push(Chunk* c) {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            slots[t & (CHUNKS - 1)] = c;
+            tail.store(t + 1, std::memory_order_release);
+        }
+        Chunk* pop() {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return nullptr;
+            Chunk* c = slots[h & (CHUNKS - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return c;
+        }
+        bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+    };
+    static_assert((CHUNKS & (CHUNKS - 1)) == 0, "CHUNKS is a power of two");
+
+    bool submit(Chunk::Kind kind);                  // hands cur over and takes a free chunk; false = dropped
+    void writerLoop();
+    void setLive(bool live);                        // wakes the writer; run start and end only
+
+    // frame thread
+    Chunk* cur = nullptr;
+    bool active = false;
+    uint32_t nextTick = 0, flapCount = 0;
+    uint64_t submitted = 0;
+    uint32_t dropped = 0;
+
+    ChunkRing full, spare;                          // full: frame -> writer, spare: writer -> frame
+    Chunk chunks[CHUNKS];
+
+    // writer thread; m only guards what flush() and the destructor wait on
+    std::mutex m;
+    std::condition_variable wake, idle;
+    std::atomic<uint64_t> completed{ 0 }, written{ 0 };
+    std::atomic<bool> runLive{ false };             // a run is being recorded: poll, don't sleep
+    bool stopping = false, failed = false;
+    const char* failedPath = nullptr;
+    int saved = 0;
+    const char* lastSaved = nullptr;
+    std::thread thread;
+};
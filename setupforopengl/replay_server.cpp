@@ -0,0 +1,493 @@
+// replay_server.cpp
+// Hop Hop Bunny - replay verification service
+// A server that takes replay files over a local (AF_UNIX) socket, plays each back with the
+// game's own GameSim and answers with the score it verified, and a load generator that
+// submits thousands of replays at once over many connections and reports verified replays/s
+// and the latency tail. Linux only; the game and headless don't need it.
+//
+// A replay is played under the server's rules, never its own: the default GameParams and the
+// game's pixel hitbox (the union of the bunny frames, as flappy and headless --mask build it),
+// or the square one with --square. A replay recorded under other constants, with god mode, with
+// another hitbox, by another build, or longer than MAX_RUN_TICKS comes back BAD_REPLAY.
+//
+// Protocol, both directions little-endian and pipelined (any number of requests in flight per
+// connection, answered in any order): VerifyRequest followed by `size` bytes of a replay file;
+// VerifyResponse per request.
+// Each connection has a reader thread that cuts the stream into requests and hands them to
+// the WorkPool in batches; a worker verifies a batch with its own GameSim and sends the
+// answers in one write.
+//
+// Build (Linux):  g++ -O2 -std=c++17 -pthread -Idependencies/include replay_server.cpp replay.cpp game_sim.cpp
+//                     collision_mask.cpp work_pool.cpp -o replay_server
+// Usage:          ./replay_server --serve /tmp/hhb_verify.sock --threads 0
+//                 ./replay_server --load /tmp/hhb_verify.sock --connections 32 --replays 20000 --inflight 64
+//                 ./replay_server --bench --threads 0 --replays 50000     (both in one process)
+
+#include "collision_mask.h"
+#include "game_sim.h"
+#include "replay.h"
+#include "work_pool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct VerifyRequest {
+    uint32_t id;                 // echoed in the response
+    uint32_t size;               // replay bytes that follow
+};
+
+enum VerifyStatus : uint32_t {
+    VERIFY_OK = 0,               // played back to exactly the recorded ending
+    VERIFY_MISMATCH = 1,         // played back, but ended differently (score is what it really got)
+    VERIFY_BAD_REPLAY = 2,       // not a replay this build can read, or not under the server's rules
+};
+
+struct VerifyResponse {
+    uint32_t id;
+    uint32_t status;
+    int32_t score;               // verified score
+    uint32_t ticks;              // verified length of the run
+    uint64_t stateHash;
+};
+
+static_assert(sizeof(VerifyRequest) == 8, "request layout");
+static_assert(sizeof(VerifyResponse) == 24, "response layout");
+
+static const uint32_t MAX_REPLAY_BYTES = 16u << 20;
+static const uint32_t MAX_RUN_TICKS = 120u * 3600u;   // an hour of play; longer claims are refused, not played
+static const int BATCH = 32;     // requests per pool task
+
+// The bunny frames the game builds its hitbox from; paths relative to the game's directory.
+static const char* const BUNNY_FRAMES[] = { "bunny sequence/bunny_sequence 1.png", "bunny sequence/bunny_sequence 2.png" };
+
+// The same hitbox flappy builds from the bunny frames: the union of the PNGs' alpha over the
+// sprite's 90x90 px frame.
+static bool loadMask(const std::vector<std::string>& paths, CollisionMask& m) {
+    m = CollisionMask();
+    m.halfW = BUNNY_HALF_W;
+    m.halfH = BUNNY_HALF_H;
+    stbi_set_flip_vertically_on_load(1);   // rows bottom-up, like the game's loader
+    for (const std::string& path : paths) {
+        int w = 0, h = 0, channels = 0;
+        unsigned char* d = stbi_load(path.c_str(), &w, &h, &channels, 4);
+        if (!d) { std::fprintf(stderr, "Failed load: %s\n", path.c_str()); return false; }
+        m.addSprite(d, w, 0, 0, w, h, 0.0f, 0.0f, 1.0f, 1.0f);
+        stbi_image_free(d);
+    }
+    m.finish();
+    if (m.empty()) { std::fprintf(stderr, "mask is empty (no opaque pixels)\n"); return false; }
+    return true;
+}
+
+static bool sendAll(int fd, const void* data, size_t n) {
+    const char* p = (const char*)data;
+    while (n) {
+        ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        p += k; n -= (size_t)k;
+    }
+    return true;
+}
+
+static bool recvAll(int fd, void* data, size_t n) {
+    char* p = (char*)data;
+    while (n) {
+        ssize_t k = recv(fd, p, n, 0);
+        if (k <= 0) return false;
+        p += k; n -= (size_t)k;
+    }
+    return true;
+}
+
+static bool socketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) { std::fprintf(stderr, "socket path too long: %s\n", path.c_str()); return false; }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// ---- server ----
+
+struct Connection {
+    int fd;
+    std::mutex writeMutex;       // workers answer from any thread
+    explicit Connection(int f) : fd(f) {}
+    ~Connection() { close(fd); }
+};
+
+struct Job { uint32_t id; std::vector<uint8_t> bytes; };
+
+class VerifyServer {
+public:
+    // rules (and the hitbox it points to) must outlive the server.
+    VerifyServer(int threads, const GameParams& rules) : pool(threads), rules(rules) {
+        for (int i = 0; i < pool.size(); i++) {
+            sims.emplace_back(new GameSim(rules));
+            replays.emplace_back(new Replay());
+        }
+    }
+
+    bool listenOn(const std::string& path) {
+        sockaddr_un addr;
+        if (!socketAddress(path, addr)) return false;
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 256) != 0) {
+            std::fprintf(stderr, "cannot listen on %s\n", path.c_str());
+            return false;
+        }
+        socketPath = path;
+        return true;
+    }
+
+    // Accepts until stop(); then waits for the connections to close and the pool to drain.
+    // Readers are detached and counted, so a long --serve doesn't collect finished threads.
+    void run() {
+        for (;;) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) break;
+            std::shared_ptr<Connection> c(new Connection(fd));
+            {
+                std::lock_guard<std::mutex> lk(readersMutex);
+                liveReaders++;
+            }
+            std::thread([this, c] {
+                readLoop(c);
+                std::lock_guard<std::mutex> lk(readersMutex);
+                if (--liveReaders == 0) readersDone.notify_all();
+            }).detach();
+        }
+        {
+            std::unique_lock<std::mutex> lk(readersMutex);
+            readersDone.wait(lk, [&] { return liveReaders == 0; });
+        }
+        pool.wait();
+        unlink(socketPath.c_str());
+    }
+
+    void stop() { shutdown(listenFd, SHUT_RDWR); close(listenFd); }
+
+    int workers() const { return pool.size(); }
+    std::atomic<uint64_t> verified{ 0 }, ticks{ 0 }, rejected{ 0 };
+
+private:
+    void readLoop(std::shared_ptr<Connection> c) {
+        std::vector<uint8_t> buf(1 << 16);
+        size_t have = 0;
+        std::vector<Job> batch;
+        for (;;) {
+            ssize_t k = recv(c->fd, buf.data() + have, buf.size() - have, 0);
+            if (k <= 0) break;
+            have += (size_t)k;
+
+            // every complete request in the buffer
+            size_t pos = 0;
+            while (have - pos >= sizeof(VerifyRequest)) {
+                VerifyRequest rq;
+                std::memcpy(&rq, buf.data() + pos, sizeof(rq));
+                if (rq.size > MAX_REPLAY_BYTES) {
+                    std::fprintf(stderr, "request of %u bytes, dropping the connection\n", rq.size);
+                    if (!batch.empty()) submit(c, batch);   // the requests before it still get their answers
+                    return;
+                }
+                if (have - pos - sizeof(rq) < rq.size) {
+                    if (sizeof(rq) + rq.size > buf.size()) buf.resize(sizeof(rq) + rq.size);
+                    break;
+                }
+                const uint8_t* body = buf.data() + pos + sizeof(rq);
+                batch.push_back({ rq.id, std::vector<uint8_t>(body, body + rq.size) });
+                pos += sizeof(rq) + rq.size;
+                if ((int)batch.size() == BATCH) submit(c, batch);
+            }
+            if (!batch.empty()) submit(c, batch);
+            std::memmove(buf.data(), buf.data() + pos, have - pos);
+            have -= pos;
+        }
+    }
+
+    void submit(const std::shared_ptr<Connection>& c, std::vector<Job>& batch) {
+        std::shared_ptr<std::vector<Job>> jobs(new std::vector<Job>());
+        jobs->swap(batch);
+        pool.submit([this, c, jobs](int worker) {
+            std::vector<VerifyResponse> out(jobs->size());
+            for (size_t i = 0; i < jobs->size(); i++) out[i] = verify((*jobs)[i], worker);
+            std::lock_guard<std::mutex> lk(c->writeMutex);
+            sendAll(c->fd, out.data(), out.size() * sizeof(VerifyResponse));   // a closed client just loses its answers
+        });
+    }
+
+    VerifyResponse verify(const Job& job, int worker) {
+        VerifyResponse res = {};
+        res.id = job.id;
+        Replay& r = *replays[worker];
+        const char* error = nullptr;
+        if (!parseReplay(job.bytes.data(), job.bytes.size(), r, &error) || !replayRulesMatch(r, rules, &error) ||
+            r.endTick > MAX_RUN_TICKS) {
+            res.status = VERIFY_BAD_REPLAY;
+            rejected++;
+            return res;
+        }
+        ReplayResult pr = playReplay(r, *sims[worker]);   // built with rules, not r.gameParams()
+        res.status = pr.matches ? VERIFY_OK : VERIFY_MISMATCH;
+        res.score = pr.score;
+        res.ticks = pr.ticks;
+        res.stateHash = pr.stateHash;
+        verified++;
+        ticks += pr.ticks;
+        return res;
+    }
+
+    WorkPool pool;
+    std::vector<std::unique_ptr<GameSim>> sims;     // one per worker, pipes reserved once
+    std::vector<std::unique_ptr<Replay>> replays;
+    const GameParams rules;
+    std::mutex readersMutex;
+    std::condition_variable readersDone;
+    int liveReaders = 0;
+    int listenFd = -1;
+    std::string socketPath;
+};
+
+// ---- load generator ----
+
+struct LoadOptions {
+    std::string socketPath;
+    int connections = 32;
+    int inflight = 64;           // requests outstanding per connection
+    long long replays = 20000;
+    int distinct = 512;          // different replays to cycle through
+    uint32_t maxTicks = 120 * 120;
+    int tamperEvery = 97;        // every Nth replay has its recorded score changed; 0 = none
+    int forgeEvery = 89;         // every Nth replay claims other rules than the server's; 0 = none
+    GameParams rules;            // the server's
+};
+
+struct Sample { std::vector<uint8_t> bytes; int score; uint32_t endTick; uint32_t expected; };
+
+// Changes what a replay claims about how it was played, in one of five ways the server must
+// refuse; a forged replay is never played, so it can't be made to pass.
+static void forgeRules(Replay& r, int kind) {
+    switch (kind % 5) {
+    case 0: r.params.godMode = true; break;
+    case 1: r.params.gravity = 0.0f; break;
+    case 2: if (r.hasMask) r.mask.rows[CollisionMask::SIZE / 2] = 0; else r.params.birdRadius *= 0.5f; break;
+    case 3: r.buildHash ^= 1; break;
+    default: r.endTick = MAX_RUN_TICKS + 1; break;
+    }
+}
+
+// Real runs to submit: the scripted player and a random one on different courses, so lengths
+// range from a few seconds to maxTicks.
+static std::vector<Sample> makeSamples(const LoadOptions& o) {
+    std::vector<Sample> samples((size_t)o.distinct);
+    const GameParams& P = o.rules;
+    for (int i = 0; i < o.distinct; i++) {
+        uint32_t seed = 1000u + (uint32_t)i;
+        GameSim sim(P, seed);
+        Replay r;
+        r.begin(P, seed);
+        uint32_t policyRng = seed * 2654435761u | 1u;
+        while (!sim.dead && sim.tick < o.maxTicks) {
+            InputFrame in;
+            if (i % 2 == 0) in.flap = scriptedFlap(sim);
+            else {
+                policyRng ^= policyRng << 13; policyRng ^= policyRng >> 17; policyRng ^= policyRng << 5;
+                in.flap = (policyRng >> 8) % 25 == 0;
+            }
+            r.record(sim, in);
+            sim.step(in);
+        }
+        r.finish(sim);
+        Sample& s = samples[(size_t)i];
+        s.score = r.score;
+        s.endTick = r.endTick;
+        s.expected = VERIFY_OK;
+        if (o.forgeEvery > 0 && i % o.forgeEvery == o.forgeEvery - 1) {
+            forgeRules(r, i / o.forgeEvery);
+            s.expected = VERIFY_BAD_REPLAY;
+            s.score = 0;
+            s.endTick = 0;
+        }
+        else if (o.tamperEvery > 0 && i % o.tamperEvery == o.tamperEvery - 1) {
+            r.score++;   // claims a point it never got
+            s.expected = VERIFY_MISMATCH;
+        }
+        serializeReplay(r, s.bytes);
+    }
+    return samples;
+}
+
+static bool runLoad(const LoadOptions& o) {
+    sockaddr_un addr;
+    if (!socketAddress(o.socketPath, addr)) return false;
+    std::vector<Sample> samples = makeSamples(o);
+    if (samples.empty()) return false;
+
+    const int C = std::max(1, o.connections);
+    std::vector<std::vector<double>> latencies((size_t)C);
+    std::atomic<long long> wrong{ 0 }, failed{ 0 };
+    std::atomic<uint64_t> ticks{ 0 };
+
+    auto client = [&](int ci) {
+        long long n = o.replays / C + (ci < o.replays % C ? 1 : 0);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            std::fprintf(stderr, "cannot connect to %s\n", o.socketPath.c_str());
+            if (fd >= 0) close(fd);
+            failed += n;
+            return;
+        }
+        std::vector<Clock::time_point> sentAt((size_t)n);
+        std::vector<double>& lat = latencies[(size_t)ci];
+        lat.reserve((size_t)n);
+        long long sent = 0, done = 0;
+        bool ok = true;
+        while (ok && done < n) {
+            while (ok && sent < n && sent - done < o.inflight) {
+                const Sample& s = samples[(size_t)((sent * C + ci) % (long long)samples.size())];
+                VerifyRequest rq = { (uint32_t)sent, (uint32_t)s.bytes.size() };
+                sentAt[(size_t)sent] = Clock::now();
+                ok = sendAll(fd, &rq, sizeof(rq)) && sendAll(fd, s.bytes.data(), s.bytes.size());
+                sent++;
+            }
+            VerifyResponse res;
+            if (!ok || !recvAll(fd, &res, sizeof(res)) || res.id >= (uint32_t)sent) { ok = false; break; }
+            lat.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt[res.id]).count());
+            const Sample& s = samples[(size_t)(((long long)res.id * C + ci) % (long long)samples.size())];
+            if (res.status != s.expected || res.score != s.score || res.ticks != s.endTick) wrong++;
+            ticks += res.ticks;
+            done++;
+        }
+        if (!ok) failed += n - done;
+        close(fd);
+    };
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < C; i++) clients.emplace_back(client, i);
+    for (auto& t : clients) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::vector<double> all;
+    for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double q) { return all.empty() ? 0.0 : all[(size_t)(q * (all.size() - 1))]; };
+
+    std::printf("load: %zu replays over %d connections, %d in flight each (%d distinct, every %d tampered, every %d forged)\n",
+        all.size(), C, o.inflight, o.distinct, o.tamperEvery, o.forgeEvery);
+    std::printf("  %.3f s  |  %.0f verified replays/s  |  %.1fM ticks/s (%.0fx real time)\n", seconds, all.size() / seconds,
+        ticks.load() / seconds / 1e6, ticks.load() / 120.0 / seconds);
+    std::printf("  latency us: p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f\n", pct(0.50), pct(0.90), pct(0.99), pct(0.999),
+        all.empty() ? 0.0 : all.back());
+    bool pass = wrong.load() == 0 && failed.load() == 0;
+    std::printf("  %lld wrong verdicts, %lld lost -> %s\n", wrong.load(), failed.load(), pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+static void printUsage() {
+    std::printf(
+        "usage: replay_server --serve SOCKET | --load SOCKET | --bench [options]\n"
+        "  --serve PATH      verify replays sent to the AF_UNIX socket at PATH until killed\n"
+        "  --load PATH       submit replays to a server at PATH and report throughput and latency\n"
+        "  --bench           a server on a temporary socket and the load against it, in one process\n"
+        "  --threads N       server workers, 0 = all cores (default 0)\n"
+        "  --mask F          the pixel hitbox from PNG F's alpha, repeat for the union (default: the game's bunny frames)\n"
+        "  --square          the square hitbox instead of the pixel one\n"
+        "  --connections N   load: client connections (default 32)\n"
+        "  --inflight N      load: requests outstanding per connection (default 64)\n"
+        "  --replays N       load: replays to submit (default 20000)\n"
+        "  --distinct N      load: different replays to cycle through (default 512)\n"
+        "  --max-ticks N     load: length limit of the generated runs (default 14400)\n"
+        "  --tamper-every N  load: every Nth distinct replay claims a wrong score, must come back MISMATCH (0 = none)\n"
+        "  --forge-every N   load: every Nth distinct replay claims other rules, must come back BAD_REPLAY (0 = none)\n");
+}
+
+int main(int argc, char** argv) {
+    enum { NONE, SERVE, LOAD, BENCH } mode = NONE;
+    int threads = 0;
+    LoadOptions lo;
+    std::vector<std::string> maskPaths;
+    bool square = false;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        auto takesValue = [&](const char* name) { return std::strcmp(a, name) == 0 && v && ++i; };
+
+        if (takesValue("--serve")) { mode = SERVE; lo.socketPath = v; }
+        else if (takesValue("--load")) { mode = LOAD; lo.socketPath = v; }
+        else if (std::strcmp(a, "--bench") == 0) mode = BENCH;
+        else if (takesValue("--threads")) threads = std::atoi(v);
+        else if (takesValue("--connections")) lo.connections = std::atoi(v);
+        else if (takesValue("--inflight")) lo.inflight = std::max(1, std::atoi(v));
+        else if (takesValue("--replays")) lo.replays = std::atoll(v);
+        else if (takesValue("--distinct")) lo.distinct = std::max(1, std::atoi(v));
+        else if (takesValue("--max-ticks")) lo.maxTicks = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (takesValue("--tamper-every")) lo.tamperEvery = std::atoi(v);
+        else if (takesValue("--forge-every")) lo.forgeEvery = std::atoi(v);
+        else if (takesValue("--mask")) maskPaths.push_back(v);
+        else if (std::strcmp(a, "--square") == 0) square = true;
+        else { printUsage(); return 1; }
+    }
+    if (mode == NONE) { printUsage(); return 1; }
+
+    // the rules replays are played under; the load generator records with the same ones
+    CollisionMask mask;
+    if (!square) {
+        if (maskPaths.empty()) maskPaths.assign(std::begin(BUNNY_FRAMES), std::end(BUNNY_FRAMES));
+        if (!loadMask(maskPaths, mask)) return 1;
+        lo.rules.birdMask = &mask;
+    }
+    if (mode == LOAD) return runLoad(lo) ? 0 : 1;
+
+    if (mode == BENCH) lo.socketPath = "/tmp/hhb_verify_" + std::to_string(getpid()) + ".sock";
+    VerifyServer server(threads, lo.rules);
+    if (!server.listenOn(lo.socketPath)) return 1;
+    std::printf("verifying replays on %s with %d workers, %s hitbox\n", lo.socketPath.c_str(), server.workers(),
+        lo.rules.birdMask ? "pixel" : "square");
+    if (mode == SERVE) {
+        // a line every few seconds while replays come in
+        std::thread stats([&] {
+            uint64_t last = 0;
+            for (;;) {
+                std::this_thread::sleep_for(std::chrono::seconds(5));
+                uint64_t n = server.verified.load();
+                if (n != last) std::printf("%llu verified (%.0f/s), %llu rejected\n", (unsigned long long)n, (n - last) / 5.0,
+                    (unsigned long long)server.rejected.load());
+                std::fflush(stdout);
+                last = n;
+            }
+        });
+        stats.detach();
+        server.run();
+        return 0;
+    }
+
+    std::thread serverThread([&] { server.run(); });
+    bool ok = runLoad(lo);
+    server.stop();
+    serverThread.join();
+    std::printf("server: %llu verified, %llu rejected, %.1fM ticks simulated\n", (unsigned long long)server.verified.load(),
+        (unsigned long long)server.rejected.load(), server.ticks.load() / 1e6);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+// ring_buffer.h
+// Hop Hop Bunny - fixed-capacity FIFO
+// Storage is allocated by reserve() and then never moves: items are pushed at the back and
+// popped from the front in O(1). Capacity is a power of two so indexing is a mask, not a
+// divide, and the items stay in one flat array for the hot loops.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+template <class T>
+class RingBuffer {
+public:
+    // Capacity is rounded up to a power of two. Keeps the items; only allocates when it grows.
+    void reserve(int n) {
+        int cap = 1;
+        while (cap < n) cap <<= 1;
+        if (cap <= capacity()) return;
+        std::vector<T> next((size_t)cap);
+        for (int i = 0; i < count; i++) next[i] = (*this)[i];
+        buf.swap(next);
+        head = 0;
+        mask = cap - 1;
+    }
+
+    int capacity() const { return (int)buf.size(); }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { head = 0; count = 0; }
+
+    // When full this doubles the storage (a slow path: size capacity for the worst case).
+    void push_back(const T& v) {
+        if (count == capacity()) reserve(count ? count * 2 : 8);
+        buf[(head + count) & mask] = v;
+        count++;
+    }
+    void pop_front() { head = (head + 1) & mask; count--; }
+
+    T& front() { return buf[head]; }
+    const T& front() const { return buf[head]; }
+    T& operator[](int i) { return buf[(head + i) & mask]; }   // i-th oldest
+    const T& operator[](int i) const { return buf[(head + i) & mask]; }
+
+    template <class R, class V>
+    struct Iter {
+        R* r; int i;
+        V& operator*() const { return (*r)[i]; }
+        Iter& operator++() { i++; return *this; }
+        bool operator!=(const Iter& o) const { return i != o.i; }
+    };
+    Iter<RingBuffer, T> begin() { return { this, 0 }; }
+    Iter<RingBuffer, T> end() { return { this, count }; }
+    Iter<const RingBuffer, const T> begin() const { return { this, 0 }; }
+    Iter<const RingBuffer, const T> end() const { return { this, count }; }
+
+private:
+    std::vector<T> buf;
+    int head = 0, count = 0, mask = 0;
+};
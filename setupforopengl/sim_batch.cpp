@@ -0,0 +1,200 @@
+// sim_batch.cpp
+// Hop Hop Bunny - structure-of-arrays multi-world stepping (scalar + SSE2 paths, dispatch)
+
+#include "sim_batch.h"
+#include "sim_batch_kernel.h"
+#include "cpu_features.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIM_BATCH_X86 1
+#include <emmintrin.h>
+#endif
+
+struct VecScalar {
+    static const int W = 1;
+    typedef float F;
+    typedef uint32_t M;
+    typedef int32_t I;
+
+    static F set1(float v) { return v; }
+    static F load(const float* p) { return *p; }
+    static void store(float* p, F v) { *p = v; }
+    static M loadM(const uint32_t* p) { return *p; }
+    static void storeM(uint32_t* p, M m) { *p = m; }
+    static I loadI(const int32_t* p) { return *p; }
+    static void storeI(int32_t* p, I v) { *p = v; }
+    static M loadFlags(const uint8_t* p) { return *p ? 0xFFFFFFFFu : 0u; }
+    static void storeFlags(uint8_t* p, M m) { *p = m ? 1 : 0; }
+
+    static F add(F a, F b) { return a + b; }
+    static F sub(F a, F b) { return a - b; }
+    static F mul(F a, F b) { return a * b; }
+    static M lt(F a, F b) { return a < b ? 0xFFFFFFFFu : 0u; }
+    static M gt(F a, F b) { return a > b ? 0xFFFFFFFFu : 0u; }
+
+    static M zeroM() { return 0u; }
+    static M and_(M a, M b) { return a & b; }
+    static M or_(M a, M b) { return a | b; }
+    static M andnot(M a, M b) { return ~a & b; }
+    static M not_(M a) { return ~a; }
+    static bool any(M m) { return m != 0; }
+    static F select(M m, F a, F b) { return m ? a : b; }
+    static I countM(I v, M m) { return v + (m ? 1 : 0); }
+};
+
+#ifdef SIM_BATCH_X86
+struct VecSSE2 {
+    static const int W = 4;
+    typedef __m128 F;
+    typedef __m128 M;
+    typedef __m128i I;
+
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static F load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, F v) { _mm_store_ps(p, v); }
+    static M loadM(const uint32_t* p) { return _mm_castsi128_ps(_mm_load_si128((const __m128i*)p)); }
+    static void storeM(uint32_t* p, M m) { _mm_store_si128((__m128i*)p, _mm_castps_si128(m)); }
+    static I loadI(const int32_t* p) { return _mm_load_si128((const __m128i*)p); }
+    static void storeI(int32_t* p, I v) { _mm_store_si128((__m128i*)p, v); }
+    static M loadFlags(const uint8_t* p) {
+        int32_t bytes;
+        std::memcpy(&bytes, p, 4);
+        __m128i z = _mm_setzero_si128();
+        __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), z), z);
+        return _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(v, z), _mm_set1_epi32(-1)));
+    }
+    static void storeFlags(uint8_t* p, M m) {
+        __m128i v = _mm_srli_epi32(_mm_castps_si128(m), 31);
+        v = _mm_packs_epi32(v, v);
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+        std::memcpy(p, &bytes, 4);
+    }
+
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+
+    static M zeroM() { return _mm_setzero_ps(); }
+    static M and_(M a, M b) { return _mm_and_ps(a, b); }
+    static M or_(M a, M b) { return _mm_or_ps(a, b); }
+    static M andnot(M a, M b) { return _mm_andnot_ps(a, b); }
+    static M not_(M a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+    static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static I countM(I v, M m) { return _mm_sub_epi32(v, _mm_castps_si128(m)); }   // mask lanes are -1
+};
+#endif
+
+void simBatchStepScalar(SimBatch& b, const uint8_t* flap, uint8_t* died) {
+    simBatchStepKernel<VecScalar>(b, flap, died);
+}
+
+void simBatchStepSSE2(SimBatch& b, const uint8_t* flap, uint8_t* died) {
+#ifdef SIM_BATCH_X86
+    simBatchStepKernel<VecSSE2>(b, flap, died);
+#else
+    simBatchStepScalar(b, flap, died);
+#endif
+}
+
+bool simBatchPathAvailable(SimBatchPath path) {
+    switch (path) {
+    case SimBatchPath::Scalar: return true;
+#ifdef SIM_BATCH_X86
+    case SimBatchPath::SSE2: return true;
+    case SimBatchPath::AVX2: { static const bool has = simBatchAVX2Built() && cpuHasAVX2(); return has; }
+#endif
+    default: return false;
+    }
+}
+
+SimBatchPath simBatchBestPath() {
+    if (simBatchPathAvailable(SimBatchPath::AVX2)) return SimBatchPath::AVX2;
+    if (simBatchPathAvailable(SimBatchPath::SSE2)) return SimBatchPath::SSE2;
+    return SimBatchPath::Scalar;
+}
+
+const char* simBatchPathName(SimBatchPath path) {
+    switch (path) {
+    case SimBatchPath::SSE2: return "sse2";
+    case SimBatchPath::AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+int simBatchRequiredPipeSlots(const GameParams& p) {
+    // a pipe lives from x = 1.2 until x + width < -1.5 and one spawns every spawnInterval (+1 tick)
+    float life = (1.2f + 1.5f + p.pipeWidth) / (p.pipeSpeed > 0.0f ? p.pipeSpeed : 1e-6f);
+    return (int)std::ceil(life / (p.spawnInterval + p.fixedDt)) + 1;
+}
+
+bool SimBatch::init(const GameParams& p, uint32_t seed) {
+    params = p;
+    int need = simBatchRequiredPipeSlots(p);
+    pipeSlots = need < SIM_BATCH_MAX_PIPES ? need : SIM_BATCH_MAX_PIPES;
+    for (int l = 0; l < SIM_BATCH_LANES; l++) resetLane(l, seed + (uint32_t)l);
+    return need <= SIM_BATCH_MAX_PIPES;
+}
+
+void SimBatch::resetLane(int l, uint32_t seed) {
+    birdY[l] = 0.0f; birdVel[l] = 0.0f;
+    timeSinceSpawn[l] = 0.0f;
+    score[l] = 0;
+    dead[l] = 0u;
+    firstFlapDone[l] = 0u;
+    tick[l] = 0;
+    rng[l] = Pcg32(seed, COURSE_STREAM);   // same course as GameSim::reset
+    spawnCursor[l] = 0;
+    scriptedFlap[l] = 0;   // no pipes yet, so the target is 0 and the bird sits on it
+    for (int s = 0; s < SIM_BATCH_MAX_PIPES; s++) {
+        pipeX[s][l] = 0.0f;
+        pipeGapY[s][l] = 0.0f;
+        pipeActive[s][l] = 0u;
+        pipeScored[s][l] = 0u;
+    }
+}
+
+void SimBatch::step(const uint8_t* flap, uint8_t* died) {
+    static const SimBatchPath best = simBatchBestPath();
+    stepWith(best, flap, died);
+}
+
+void SimBatch::stepWith(SimBatchPath path, const uint8_t* flap, uint8_t* died) {
+    switch (path) {
+    case SimBatchPath::AVX2: simBatchStepAVX2(*this, flap, died); break;
+    case SimBatchPath::SSE2: simBatchStepSSE2(*this, flap, died); break;
+    default: simBatchStepScalar(*this, flap, died); break;
+    }
+}
+
+void SimBatch::exportLane(int l, GameSim& out) const {
+    out.params = params;
+    out.birdY = birdY[l]; out.birdVel = birdVel[l];
+    out.timeSinceSpawn = timeSinceSpawn[l];
+    out.score = score[l];
+    out.dead = dead[l] != 0;
+    out.firstFlapDone = firstFlapDone[l] != 0;
+    out.tick = tick[l];
+    out.rng = rng[l];
+
+    // slots are a ring in spawn order, oldest first starting at the cursor
+    out.pipes.clear();
+    out.nearPipe = 0;
+    out.pipes.reserve(maxLivePipes(params));
+    for (int i = 0; i < pipeSlots; i++) {
+        int s = (int)(spawnCursor[l] + i) % pipeSlots;
+        if (!pipeActive[s][l]) continue;
+        Pipe p;
+        p.x = pipeX[s][l];
+        p.gapY = pipeGapY[s][l];
+        p.width = params.pipeWidth;
+        p.gapSize = params.pipeGapSize;
+        p.scored = pipeScored[s][l] != 0;
+        out.pipes.push_back(p);
+    }
+}
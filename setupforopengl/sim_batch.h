@@ -0,0 +1,66 @@
+// sim_batch.h
+// Hop Hop Bunny - structure-of-arrays multi-world stepping
+// Steps SIM_BATCH_LANES independent worlds per call with the same rules as GameSim::step.
+// Bird state and per-world pipe slots are laid out lane-contiguous so the update runs
+// 8 worlds per AVX2 instruction (4 per SSE2), with a scalar fallback that produces
+// bit-identical results. Only the square birdRadius hitbox: params.birdMask is ignored.
+
+#pragma once
+
+#include "game_sim.h"
+
+#include <cstdint>
+
+const int SIM_BATCH_LANES = 16;
+const int SIM_BATCH_MAX_PIPES = 16;
+
+enum class SimBatchPath { Scalar, SSE2, AVX2 };
+
+struct alignas(32) SimBatch {
+    GameParams params;
+    int pipeSlots = SIM_BATCH_MAX_PIPES;   // slots in use per world, sized from params by init()
+
+    // per-lane world state; masks are 0 or 0xFFFFFFFF so they can be used as SIMD lane masks
+    alignas(32) float birdY[SIM_BATCH_LANES];
+    alignas(32) float birdVel[SIM_BATCH_LANES];
+    alignas(32) float timeSinceSpawn[SIM_BATCH_LANES];
+    alignas(32) int32_t score[SIM_BATCH_LANES];
+    alignas(32) uint32_t dead[SIM_BATCH_LANES];
+    alignas(32) uint32_t firstFlapDone[SIM_BATCH_LANES];
+    alignas(32) uint32_t tick[SIM_BATCH_LANES];
+    Pcg32 rng[SIM_BATCH_LANES];
+    alignas(32) uint32_t spawnCursor[SIM_BATCH_LANES];
+
+    // pipe slots, [slot][lane]; width and gap size come from params
+    alignas(32) float pipeX[SIM_BATCH_MAX_PIPES][SIM_BATCH_LANES];
+    alignas(32) float pipeGapY[SIM_BATCH_MAX_PIPES][SIM_BATCH_LANES];
+    alignas(32) uint32_t pipeActive[SIM_BATCH_MAX_PIPES][SIM_BATCH_LANES];
+    alignas(32) uint32_t pipeScored[SIM_BATCH_MAX_PIPES][SIM_BATCH_LANES];
+
+    // scriptedFlap (game_sim.h) for the tick each lane is about to step, worked out by the
+    // kernel at the end of every step; it can be passed straight back in as the flap array.
+    alignas(32) uint8_t scriptedFlap[SIM_BATCH_LANES];
+
+    // Returns false if params would need more live pipes per world than SIM_BATCH_MAX_PIPES.
+    bool init(const GameParams& p, uint32_t seed);
+    void resetLane(int lane, uint32_t seed);
+
+    // flap[lane] != 0 flaps that world this tick; died[lane] is set to 1 if the world died
+    // during this tick (0 otherwise). Both arrays have SIM_BATCH_LANES entries.
+    void step(const uint8_t* flap, uint8_t* died);
+    void stepWith(SimBatchPath path, const uint8_t* flap, uint8_t* died);
+
+    // Copy one lane out into a regular GameSim (for checks and debugging).
+    void exportLane(int lane, GameSim& out) const;
+};
+
+int simBatchRequiredPipeSlots(const GameParams& p);
+bool simBatchPathAvailable(SimBatchPath path);
+SimBatchPath simBatchBestPath();
+const char* simBatchPathName(SimBatchPath path);
+
+// implemented per instruction set (sim_batch.cpp, sim_batch_avx2.cpp)
+bool simBatchAVX2Built();
+void simBatchStepScalar(SimBatch& b, const uint8_t* flap, uint8_t* died);
+void simBatchStepSSE2(SimBatch& b, const uint8_t* flap, uint8_t* died);
+void simBatchStepAVX2(SimBatch& b, const uint8_t* flap, uint8_t* died);
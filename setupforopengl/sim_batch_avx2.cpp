@@ -0,0 +1,67 @@
+// sim_batch_avx2.cpp
+// Hop Hop Bunny - AVX2 path of the SoA batch step.
+// This file alone is compiled with AVX2 enabled (-mavx2, or /arch:AVX2 per file in VS);
+// it is only called after simBatchPathAvailable(SimBatchPath::AVX2) said the CPU has it.
+
+#include "sim_batch.h"
+#include "sim_batch_kernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+struct VecAVX2 {
+    static const int W = 8;
+    typedef __m256 F;
+    typedef __m256 M;
+    typedef __m256i I;
+
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, F v) { _mm256_store_ps(p, v); }
+    static M loadM(const uint32_t* p) { return _mm256_castsi256_ps(_mm256_load_si256((const __m256i*)p)); }
+    static void storeM(uint32_t* p, M m) { _mm256_store_si256((__m256i*)p, _mm256_castps_si256(m)); }
+    static I loadI(const int32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+    static void storeI(int32_t* p, I v) { _mm256_store_si256((__m256i*)p, v); }
+    // W bytes, nonzero = set, to and from a mask in registers (no scalar round trip through memory)
+    static M loadFlags(const uint8_t* p) {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+        return _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(-1)));
+    }
+    static void storeFlags(uint8_t* p, M m) {
+        __m256i v = _mm256_srli_epi32(_mm256_castps_si256(m), 31);
+        __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w));
+    }
+
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+    static M zeroM() { return _mm256_setzero_ps(); }
+    static M and_(M a, M b) { return _mm256_and_ps(a, b); }
+    static M or_(M a, M b) { return _mm256_or_ps(a, b); }
+    static M andnot(M a, M b) { return _mm256_andnot_ps(a, b); }
+    static M not_(M a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+    static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+    static I countM(I v, M m) { return _mm256_sub_epi32(v, _mm256_castps_si256(m)); }
+};
+
+bool simBatchAVX2Built() { return true; }
+
+void simBatchStepAVX2(SimBatch& b, const uint8_t* flap, uint8_t* died) {
+    simBatchStepKernel<VecAVX2>(b, flap, died);
+}
+
+#else
+
+// built without AVX2 support: never selected at runtime, but keep the symbol
+bool simBatchAVX2Built() { return false; }
+
+void simBatchStepAVX2(SimBatch& b, const uint8_t* flap, uint8_t* died) {
+    simBatchStepSSE2(b, flap, died);
+}
+
+#endif
@@ -0,0 +1,157 @@
+// sim_batch_kernel.h
+// Hop Hop Bunny - SoA step kernel shared by the scalar, SSE2 and AVX2 batch paths.
+// Only included by sim_batch*.cpp. V is a small traits struct that wraps one instruction set:
+//   F = float vector, M = lane mask, I = int32 vector, W = lanes per vector.
+// The byte arrays (flap in, died and scriptedFlap out) go through loadFlags/storeFlags so no
+// lane state makes a scalar round trip through memory; that alone cost a third of a step.
+// Every float operation here mirrors GameSim::step one to one (same operands, same order, no
+// fused multiply-add), which is what keeps all paths bit-identical to each other and to GameSim.
+
+#pragma once
+
+#include "sim_batch.h"
+
+template <class V>
+void simBatchStepKernel(SimBatch& b, const uint8_t* flap, uint8_t* died) {
+    typedef typename V::F F;
+    typedef typename V::M M;
+    typedef typename V::I I;
+
+    const GameParams& P = b.params;
+    const float dt = P.fixedDt;
+    const float halfW = P.pipeWidth * 0.5f;
+    const float halfGap = P.pipeGapSize * 0.5f;
+
+    const F vDt = V::set1(dt);
+    const F vGravDt = V::set1(P.gravity * dt);
+    const F vFlap = V::set1(P.flapStrength);
+    const F vRadius = V::set1(P.birdRadius);
+    const F vOne = V::set1(1.0f);
+    const F vMinusOne = V::set1(-1.0f);
+    const F vCeil = V::set1(1.0f - P.birdRadius);
+    const F vFloor = V::set1(-1.0f + P.birdRadius);
+    const F vZero = V::set1(0.0f);
+    const F vSpawnInterval = V::set1(P.spawnInterval);
+    const F vScroll = V::set1(P.pipeSpeed * dt);
+    const F vInvScroll = V::set1(P.pipeSpeed * dt > 0.0f ? 1.0f / (P.pipeSpeed * dt) : 0.0f);
+    const F vHalfW = V::set1(halfW);
+    const F vWidth = V::set1(P.pipeWidth);
+    const F vHalfGap = V::set1(halfGap);
+    const F vBirdX = V::set1(P.birdX);
+    const F vBirdRight = V::set1(P.birdX + P.birdRadius);
+    const F vBirdLeft = V::set1(P.birdX - P.birdRadius);
+    const F vCull = V::set1(-1.5f);
+    const F vFar = V::set1(1e9f);
+    const F vAim = V::set1(0.06f);
+
+    for (int c = 0; c < SIM_BATCH_LANES; c += V::W) {
+        F y = V::load(b.birdY + c);
+        F vel = V::load(b.birdVel + c);
+        M dead = V::loadM(b.dead + c);
+        M firstFlap = V::loadM(b.firstFlapDone + c);
+        M wasDead = dead;
+        F y0 = y;
+
+        // flap, then integrate
+        M flapNow = V::andnot(dead, V::loadFlags(flap + c));
+        vel = V::select(flapNow, vFlap, vel);
+        firstFlap = V::or_(firstFlap, flapNow);
+
+        F vel2 = V::add(vel, vGravDt);
+        F y2 = V::add(y, V::mul(vel2, vDt));
+        vel = V::select(firstFlap, vel2, vel);
+        y = V::select(firstFlap, y2, y);
+
+        // ceiling / floor
+        M hitCeil = V::gt(V::add(y, vRadius), vOne);
+        y = V::select(hitCeil, vCeil, y);
+        vel = V::select(hitCeil, vZero, vel);
+
+        M hitFloor = V::lt(V::sub(y, vRadius), vMinusOne);
+        y = V::select(hitFloor, vFloor, y);
+        if (!P.godMode) dead = V::or_(dead, hitFloor);
+
+        // spawn timer; the actual insert is rare and per lane, so it stays scalar
+        M alive = V::not_(dead);
+        F tss = V::load(b.timeSinceSpawn + c);
+        tss = V::select(alive, V::add(tss, vDt), tss);
+        M spawn = V::and_(alive, V::gt(tss, vSpawnInterval));
+        tss = V::select(spawn, vZero, tss);
+        V::store(b.timeSinceSpawn + c, tss);
+
+        if (V::any(spawn)) {
+            alignas(32) uint32_t spawnBits[V::W];
+            V::storeM(spawnBits, spawn);
+            for (int k = 0; k < V::W; k++) {
+                if (!spawnBits[k]) continue;
+                int lane = c + k;
+                uint32_t slot = b.spawnCursor[lane];
+                b.spawnCursor[lane] = (slot + 1) % (uint32_t)b.pipeSlots;
+                b.pipeX[slot][lane] = 1.2f;
+                b.pipeGapY[slot][lane] = spawnGapY(P, b.rng[lane].unit());
+                b.pipeActive[slot][lane] = 0xFFFFFFFFu;
+                b.pipeScored[slot][lane] = 0u;
+            }
+        }
+
+        // scroll, score, cull and collide every pipe slot. The sweep uses the full scroll in
+        // every lane; lanes that are not alive are dead already, so their hit is never used.
+        I score = V::loadI(b.score + c);
+        M hit = V::zeroM();
+        F nearX = vFar, target = vZero;   // scriptedFlap: gap of the nearest pipe not yet past the bird
+        F dy = V::sub(y, y0);
+        for (int s = 0; s < b.pipeSlots; s++) {
+            M active = V::loadM(b.pipeActive[s] + c);
+            if (!V::any(active)) continue;
+
+            F x = V::load(b.pipeX[s] + c);
+            x = V::select(V::and_(alive, active), V::sub(x, vScroll), x);   // free slots stay untouched
+            V::store(b.pipeX[s] + c, x);
+
+            M scored = V::loadM(b.pipeScored[s] + c);
+            M newScore = V::andnot(scored, V::and_(active, V::lt(V::add(x, vHalfW), vBirdX)));
+            score = V::countM(score, newScore);
+            V::storeM(b.pipeScored[s] + c, V::or_(scored, newScore));
+
+            active = V::andnot(V::lt(V::add(x, vWidth), vCull), active);
+            V::storeM(b.pipeActive[s] + c, active);
+
+            F gapY = V::load(b.pipeGapY[s] + c);
+            M ahead = V::and_(active, V::and_(V::not_(V::lt(V::add(x, vHalfW), vBirdLeft)), V::lt(x, nearX)));
+            nearX = V::select(ahead, x, nearX);
+            target = V::select(ahead, gapY, target);
+
+            // pipeSweptHit
+            F pl = V::sub(x, vHalfW);
+            F pr = V::add(x, vHalfW);
+            F ua = V::sub(vBirdLeft, pr);
+            F ub = V::sub(vBirdRight, pl);
+            ua = V::select(V::lt(ua, vZero), vZero, ua);
+            ub = V::select(V::gt(ub, vScroll), vScroll, ub);
+            M outsideX = V::lt(ub, ua);
+            M under = V::andnot(outsideX, active);
+            if (!V::any(under)) continue;   // most slots: no lane has this pipe under the bird
+            F ya = V::sub(y, V::mul(dy, V::mul(ua, vInvScroll)));
+            F yb = V::sub(y, V::mul(dy, V::mul(ub, vInvScroll)));
+            M aHigher = V::gt(ya, yb);
+            F hi = V::select(aHigher, ya, yb);
+            F lo = V::select(aHigher, yb, ya);
+            F gt = V::add(gapY, vHalfGap);
+            F gb = V::sub(gapY, vHalfGap);
+            M insideGap = V::and_(V::lt(V::add(hi, vRadius), gt), V::gt(V::sub(lo, vRadius), gb));
+            hit = V::or_(hit, V::andnot(insideGap, under));
+        }
+        V::storeI(b.score + c, score);
+
+        if (!P.godMode) dead = V::or_(dead, hit);
+        V::store(b.birdY + c, y);
+        V::store(b.birdVel + c, vel);
+        V::storeM(b.dead + c, dead);
+        V::storeM(b.firstFlapDone + c, firstFlap);
+
+        int32_t* tick = (int32_t*)(b.tick + c);
+        V::storeI(tick, V::countM(V::loadI(tick), V::not_(V::zeroM())));
+        V::storeFlags(died + c, V::andnot(wasDead, dead));
+        V::storeFlags(b.scriptedFlap + c, V::and_(V::lt(y, V::sub(target, vAim)), V::not_(V::gt(vel, vZero))));
+    }
+}
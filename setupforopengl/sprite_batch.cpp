@@ -0,0 +1,108 @@
+// sprite_batch.cpp
+// Hop Hop Bunny - batched 2D sprite renderer
+
+#include "sprite_batch.h"
+
+#include <cstring>
+
+static const int FLOATS_PER_VERT = 5;
+static const int VERTS_PER_QUAD = 4;
+
+void SpriteBatch::init(GLuint program, int maxQuadsPerFlush) {
+    prog = program;
+    locTex = glGetUniformLocation(prog, "uTex");
+    maxQuads = maxQuadsPerFlush;
+    verts.reserve((size_t)maxQuads * VERTS_PER_QUAD * FLOATS_PER_VERT);
+
+    // index pattern is the same for every quad, so it is built once
+    std::vector<GLuint> idx((size_t)maxQuads * 6);
+    for (int q = 0; q < maxQuads; q++) {
+        GLuint b = (GLuint)q * 4;
+        GLuint* i = &idx[(size_t)q * 6];
+        i[0] = b; i[1] = b + 1; i[2] = b + 2; i[3] = b; i[4] = b + 2; i[5] = b + 3;
+    }
+
+    // a few flushes' worth of room so consecutive flushes in a frame never wait on the GPU
+    bufSize = (GLsizeiptr)maxQuads * VERTS_PER_QUAD * FLOATS_PER_VERT * sizeof(float) * 4;
+
+    glGenVertexArrays(1, &vao); glGenBuffers(1, &vbo); glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, bufSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERT * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERT * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, FLOATS_PER_VERT * sizeof(float), (void*)(4 * sizeof(float)));
+    glBindVertexArray(0);
+}
+
+void SpriteBatch::destroy() {
+    glDeleteBuffers(1, &vbo); glDeleteBuffers(1, &ebo); glDeleteVertexArrays(1, &vao);
+    vbo = ebo = vao = 0;
+}
+
+void SpriteBatch::draw(GLuint tex, float cx, float cy, float w, float h, int fbw, int fbh, float alpha,
+    float u0, float v0, float u1, float v1) {
+    if (!tex) return;
+    if (tex != curTex || (int)(verts.size() / (VERTS_PER_QUAD * FLOATS_PER_VERT)) >= maxQuads) {
+        flush();
+        curTex = tex;
+    }
+
+    // same mapping the old per-sprite shader did with uPos/uScale
+    float nx = (cx / fbw) * 2.0f - 1.0f, ny = 1.0f - (cy / fbh) * 2.0f;
+    float hx = (w / (float)fbw), hy = (h / (float)fbh);
+    float x0 = nx - hx, x1 = nx + hx, y0 = ny - hy, y1 = ny + hy;
+
+    const float q[VERTS_PER_QUAD * FLOATS_PER_VERT] = {
+        x0, y0, u0, v0, alpha,
+        x1, y0, u1, v0, alpha,
+        x1, y1, u1, v1, alpha,
+        x0, y1, u0, v1, alpha,
+    };
+    verts.insert(verts.end(), q, q + VERTS_PER_QUAD * FLOATS_PER_VERT);
+}
+
+void SpriteBatch::draw(const Sprite& s, float cx, float cy, float w, float h, int fbw, int fbh, float alpha) {
+    // frame is centred on (cx, cy); pixel y grows down while fy grows up
+    float left = cx - w * 0.5f, bottom = cy + h * 0.5f;
+    float scx = left + (s.fx0 + s.fx1) * 0.5f * w;
+    float scy = bottom - (s.fy0 + s.fy1) * 0.5f * h;
+    draw(s.tex, scx, scy, (s.fx1 - s.fx0) * w, (s.fy1 - s.fy0) * h, fbw, fbh, alpha, s.u0, s.v0, s.u1, s.v1);
+}
+
+void SpriteBatch::flush() {
+    if (verts.empty()) return;
+    int n = (int)(verts.size() / (VERTS_PER_QUAD * FLOATS_PER_VERT));
+    GLsizeiptr bytes = (GLsizeiptr)(verts.size() * sizeof(float));
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    if (bufOffset + bytes > bufSize) {
+        // ring is full: orphan the storage so the driver hands us fresh memory
+        bufOffset = 0;
+        access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+    }
+    void* dst = glMapBufferRange(GL_ARRAY_BUFFER, bufOffset, bytes, access);
+    if (dst) {
+        std::memcpy(dst, verts.data(), (size_t)bytes);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else {
+        glBufferSubData(GL_ARRAY_BUFFER, bufOffset, bytes, verts.data());
+    }
+
+    glUseProgram(prog);
+    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, curTex);
+    glUniform1i(locTex, 0);
+    GLint baseVertex = (GLint)(bufOffset / (FLOATS_PER_VERT * sizeof(float)));
+    glDrawElementsBaseVertex(GL_TRIANGLES, n * 6, GL_UNSIGNED_INT, (void*)0, baseVertex);
+
+    bufOffset += bytes;
+    drawCalls++;
+    quads += n;
+    verts.clear();
+}
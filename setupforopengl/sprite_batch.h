@@ -0,0 +1,52 @@
+// sprite_batch.h
+// Hop Hop Bunny - batched 2D sprite renderer
+// Sprites are appended as quads (pixel-space centre/size -> NDC on the CPU) into a streaming
+// vertex buffer and drawn with one glDrawElements per run of sprites sharing a texture.
+// Draw order is preserved: a texture change (or an explicit flush) ends the current run.
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// A drawable image: a texture plus the sub-rect it occupies. For atlas sprites the trimmed
+// rect is placed inside the original frame (fx/fy), so callers keep sizing sprites by their
+// full untrimmed frame exactly as before.
+struct Sprite {
+    GLuint tex = 0;
+    float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+    float fx0 = 0, fy0 = 0, fx1 = 1, fy1 = 1;
+    explicit operator bool() const { return tex != 0; }
+};
+
+struct SpriteBatch {
+    GLuint prog = 0, vao = 0, vbo = 0, ebo = 0;
+    GLint locTex = -1;
+
+    int maxQuads = 0;
+    std::vector<float> verts;     // pending quads, 4 vertices x (x, y, u, v, alpha)
+    GLuint curTex = 0;
+    GLintptr bufOffset = 0;       // write position in the streaming buffer (bytes)
+    GLsizeiptr bufSize = 0;
+
+    int drawCalls = 0;            // since the last resetStats()
+    int quads = 0;
+
+    // program must have aPos (0), aUV (1), aAlpha (2) and a sampler uniform uTex.
+    void init(GLuint program, int maxQuadsPerFlush = 4096);
+    void destroy();
+
+    // (cx, cy) is the sprite centre in pixels from the top-left, (w, h) its size in pixels.
+    // UVs default to the whole texture.
+    void draw(GLuint tex, float cx, float cy, float w, float h, int fbw, int fbh, float alpha = 1.0f,
+        float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f);
+
+    // Same as draw() but for a (possibly trimmed) sprite; w/h are the full frame size.
+    void draw(const Sprite& s, float cx, float cy, float w, float h, int fbw, int fbh, float alpha = 1.0f);
+
+    // Submit pending quads. Call before drawing anything with another program, and before swap.
+    void flush();
+
+    void resetStats() { drawCalls = 0; quads = 0; }
+};
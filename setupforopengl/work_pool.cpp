@@ -0,0 +1,92 @@
+// work_pool.cpp
+// Hop Hop Bunny - work-stealing thread pool
+
+#include "work_pool.h"
+
+WorkPool::WorkPool(int n) {
+    if (n <= 0) n = (int)std::thread::hardware_concurrency();
+    if (n <= 0) n = 1;
+    for (int i = 0; i < n; i++) queues.emplace_back(new Queue());
+    for (int i = 0; i < n; i++) threads.emplace_back(&WorkPool::workerLoop, this, i);
+}
+
+WorkPool::~WorkPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+        stopping = true;
+    }
+    sleepCv.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void WorkPool::submit(Task task) {
+    pending++;
+    Queue& q = *queues[nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lk(q.m);
+        q.tasks.push_back(std::move(task));
+    }
+    queued++;
+    {
+        // taking the lock orders this with a worker that is about to sleep
+        std::lock_guard<std::mutex> lk(sleepMutex);
+    }
+    sleepCv.notify_one();
+}
+
+void WorkPool::wait() {
+    std::unique_lock<std::mutex> lk(sleepMutex);
+    doneCv.wait(lk, [&] { return pending.load() == 0; });
+}
+
+void WorkPool::parallelFor(long long count, long long grain, const std::function<void(long long, long long, int)>& fn) {
+    if (grain < 1) grain = 1;
+    for (long long b = 0; b < count; b += grain) {
+        long long e = b + grain < count ? b + grain : count;
+        submit([&fn, b, e](int worker) { fn(b, e, worker); });
+    }
+    wait();
+}
+
+bool WorkPool::popLocal(int worker, Task& out) {
+    Queue& q = *queues[worker];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (q.tasks.empty()) return false;
+    out = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    return true;
+}
+
+bool WorkPool::steal(int worker, Task& out) {
+    int n = (int)queues.size();
+    for (int i = 1; i < n; i++) {
+        Queue& q = *queues[(worker + i) % n];
+        std::unique_lock<std::mutex> lk(q.m, std::try_to_lock);
+        if (!lk.owns_lock() || q.tasks.empty()) continue;
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        steals++;
+        return true;
+    }
+    return false;
+}
+
+void WorkPool::workerLoop(int worker) {
+    for (;;) {
+        Task task;
+        if (popLocal(worker, task) || steal(worker, task)) {
+            queued--;
+            task(worker);
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lk(sleepMutex);
+                doneCv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepMutex);
+        sleepCv.wait(lk, [&] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,64 @@
+// work_pool.h
+// Hop Hop Bunny - work-stealing thread pool
+// Each worker owns a task deque: it pops its own work from the front and, when empty,
+// steals from the back of another worker's deque, so uneven tasks (short vs long episodes)
+// still keep every core busy.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkPool {
+public:
+    typedef std::function<void(int worker)> Task;
+
+    explicit WorkPool(int threads = 0);   // 0 = one worker per hardware thread
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    int size() const { return (int)threads.size(); }
+
+    // Queue a task; tasks are spread round-robin over the worker deques.
+    void submit(Task task);
+
+    // Block until every submitted task has finished.
+    void wait();
+
+    // Run fn(begin, end, worker) over [0, count) in chunks of `grain` and wait for completion.
+    void parallelFor(long long count, long long grain, const std::function<void(long long, long long, int)>& fn);
+
+    uint64_t stealCount() const { return steals.load(); }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int worker, Task& out);
+    bool steal(int worker, Task& out);
+    void workerLoop(int worker);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;   // workers wait here for new tasks
+    std::condition_variable doneCv;    // wait() waits here for pending == 0
+
+    std::atomic<long long> queued{ 0 };    // tasks sitting in deques
+    std::atomic<long long> pending{ 0 };   // tasks submitted but not finished
+    std::atomic<uint64_t> steals{ 0 };
+    std::atomic<unsigned> nextQueue{ 0 };
+    bool stopping = false;
+};